@@ -1,20 +1,44 @@
 #include <iostream>
 #include <vector>
 #include <string>
-#include <sstream>
+#include "trace_writer.h"
+#include "trace_line.h"
+#include "step_session.h"
+#include "tracer.h"
 using namespace std;
 int N;
-void emitStep(const vector<string>& board, const string& message, int row, int col, bool placing) {
-    stringstream ss;
-    ss << R"({"board":[)";
+void emitStep(const vector<string>& board, const msg::Message& message, int row, int col, bool placing) {
+    static trace::Line line;
+    line.raw(R"({"board":[)");
     for (int i = 0; i < board.size(); ++i) {
-        ss << "\"" << board[i] << "\"";
-        if (i != board.size() - 1) ss << ",";
+        line.quoted(board[i]);
+        if (i != board.size() - 1) line.raw(",");
     }
-    ss << R"(],"message":")" << message << R"(","row":)" << row << R"(,"col":)" << col << R"(,"placing":)" << (placing ? "true" : "false") << "}";
-    cout << ss.str() << endl;
-    cout.flush();
+    line.raw("],").message(message, false);
+    line.raw(R"(,"row":)").number(row).raw(R"(,"col":)").number(col).raw(R"(,"placing":)").raw(placing ? "true" : "false").raw("}");
+    line.emit();
 }
+// Streams every step to the visualizer.
+struct StreamTracer {
+    static constexpr bool enabled = true;
+
+    void step(const vector<string>& board, const msg::Message& message, int row, int col, bool placing) {
+        emitStep(board, message, row, col, placing);
+    }
+};
+// One step of the search; the board is read when the step is emitted, while
+// solveSteps() is suspended at the yield.
+struct BoardStep {
+    msg::Message message;
+    int row;
+    int col;
+    bool placing;
+
+    // A real constructor rather than aggregate init: GCC 12 double-destroys
+    // aggregate temporaries passed to co_yield.
+    BoardStep(msg::Message message, int row, int col, bool placing)
+        : message(message), row(row), col(col), placing(placing) {}
+};
 bool isSafe(const vector<string>& board, int row, int col) {
     for (int i = 0; i < row; ++i)
         if (board[i][col] == 'Q') return false;
@@ -26,29 +50,47 @@ bool isSafe(const vector<string>& board, int row, int col) {
 }
 bool solutionFound = false;
 
-bool solve(vector<string>& board, int row) {
+// The search as a coroutine, so that --step runs can pull its steps one at
+// a time; solve() drains it into a tracer for everything else. Without
+// `yieldSteps` it yields nothing and runs to the end in a single resume.
+Generator<BoardStep> solveSteps(vector<string>& board, int row, bool yieldSteps = true) {
     if (row == N) {
-        emitStep(board, " Solution found!", -1, -1, false);
-        return true; // stop recursion here
+        solutionFound = true;
+        if (yieldSteps) co_yield BoardStep(msg::Message(msg::SolutionFound), -1, -1, false);
+        co_return; // stop recursion here
     }
 
     for (int col = 0; col < N; ++col) {
-        emitStep(board, "Trying queen at (" + to_string(row) + "," + to_string(col) + ")", row, col, true);
+        if (yieldSteps) co_yield BoardStep(msg::Message(msg::TryQueen, row, col), row, col, true);
         if (isSafe(board, row, col)) {
             board[row][col] = 'Q';
-            emitStep(board, "Placed queen at (" + to_string(row) + "," + to_string(col) + ")", row, col, true);
-            if (solve(board, row + 1)) return true; 
+            if (yieldSteps) co_yield BoardStep(msg::Message(msg::PlaceQueen, row, col), row, col, true);
+            for (const auto& step : solveSteps(board, row + 1, yieldSteps)) co_yield step;
+            if (solutionFound) co_return;
             board[row][col] = '.';
-            emitStep(board, "Backtracking from (" + to_string(row) + "," + to_string(col) + ")", row, col, false);
+            if (yieldSteps) co_yield BoardStep(msg::Message(msg::Backtrack, row, col), row, col, false);
         } else {
-            emitStep(board, "Position (" + to_string(row) + "," + to_string(col) + ") is not safe", row, col, false);
+            if (yieldSteps) co_yield BoardStep(msg::Message(msg::NotSafe, row, col), row, col, false);
         }
     }
+    // no solution in this path
+}
 
-    return false; // no solution in this path
+template <class Tracer>
+void solve(vector<string>& board, Tracer& trace) {
+    for (const auto& step : solveSteps(board, 0, Tracer::enabled)) {
+        trace.step(board, step.message, step.row, step.col, step.placing);
+    }
 }
 
 int main(int argc, char* argv[]) {
+    // --step: advance only as far as the client asks (see step_session.h)
+    bool stepMode = argc > 1 && string(argv[1]) == "--step";
+    if (stepMode) {
+        --argc;
+        ++argv;
+    }
+
     if (argc > 1) {
         N = stoi(argv[1]);
     } else {
@@ -56,14 +98,20 @@ int main(int argc, char* argv[]) {
     }
 
     if (N < 1) {
-        cout << R"({"error":"Invalid N"})" << endl;
+        trace::emit(R"({"error":"Invalid N"})");
         return 1;
     }
 
     vector<string> board(N, string(N, '.'));
-    solve(board, 0);
+    if (stepMode) {
+        auto steps = solveSteps(board, 0);
+        auto emit = [&](const BoardStep& step) { emitStep(board, step.message, step.row, step.col, step.placing); };
+        if (!serveSteps(steps, emit)) return 0;
+    } else {
+        SelectedTracer<StreamTracer> tracer;
+        solve(board, tracer);
+    }
 
-    cout << R"({"action":"final"})" << endl;
-    cout.flush();
+    trace::emit(R"({"action":"final"})");
     return 0;
 }
@@ -8,6 +8,15 @@
 #include <unordered_set>
 #include <set>
 #include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include "trace_writer.h"
+#include "trace_line.h"
+#include "tracer.h"
+#include "shortest_path.h"
+#include "all_pairs.h"
+#include "bulk_input.h"
 using namespace std;
 struct Edge {
     int to;
@@ -15,30 +24,46 @@ struct Edge {
 };
 using Graph = unordered_map<int, vector<Edge>>;
 static int STEP = 0;
-void printStep(const string& type, int a, int b, const string& explanation) {
+void printStep(const char* type, int a, int b, const msg::Message& message) {
     // a is node or u, b is value or v depending on type
-    cout << "{"
-         << "\"step\":" << STEP++ << ","
-         << "\"type\":\"" << type << "\","
-         << "\"a\":" << a << ","
-         << "\"b\":" << b << ","
-         << "\"explanation\":\"" << explanation << "\""
-         << "}" << endl;
+    static trace::Line line;
+    line.raw("{\"step\":").number(STEP++)
+        .raw(",\"type\":\"").raw(type)
+        .raw("\",\"a\":").number(a)
+        .raw(",\"b\":").number(b)
+        .raw(",").message(message, false)
+        .raw("}");
+    line.emit();
 }
 
-void printFinalPath(const vector<int>& path, int cost) {
+// Streams every step to the visualizer.
+struct StreamTracer {
+    static constexpr bool enabled = true;
+
+    void step(const char* type, int a, int b, const msg::Message& message) {
+        printStep(type, a, b, message);
+    }
+};
+
+string joinPath(const vector<int>& path) {
     ostringstream oss;
     for (size_t i = 0; i < path.size(); ++i) {
         oss << path[i];
         if (i + 1 < path.size()) oss << "->";
     }
-    cout << "{"
-         << "\"step\":" << STEP++ << ","
-         << "\"type\":\"final\","
-         << "\"path\":\"" << oss.str() << "\","
-         << "\"cost\":" << cost << ","
-         << "\"explanation\":\"Shortest path found with total cost " << cost << "\""
-         << "}" << endl;
+    return oss.str();
+}
+
+void printFinalPath(const vector<int>& path, int cost) {
+    ostringstream out;
+    out << "{"
+        << "\"step\":" << STEP++ << ","
+        << "\"type\":\"final\","
+        << "\"path\":\"" << joinPath(path) << "\","
+        << "\"cost\":" << cost << ","
+        << "\"explanation\":\"Shortest path found with total cost " << cost << "\""
+        << "}";
+    trace::emit(out.str());
 }
 
 void printFinalMST(int cost, const vector<pair<int, int>>& edges) {
@@ -46,13 +71,15 @@ void printFinalMST(int cost, const vector<pair<int, int>>& edges) {
     for (const auto& [u, v] : edges) {
         oss << "(" << u << "-" << v << ") ";
     }
-    cout << "{"
-         << "\"step\":" << STEP++ << ","
-         << "\"type\":\"final\","
-         << "\"mst\":\"" << oss.str() << "\","
-         << "\"cost\":" << cost << ","
-         << "\"explanation\":\"MST complete with total cost " << cost << "\""
-         << "}" << endl;
+    ostringstream out;
+    out << "{"
+        << "\"step\":" << STEP++ << ","
+        << "\"type\":\"final\","
+        << "\"mst\":\"" << oss.str() << "\","
+        << "\"cost\":" << cost << ","
+        << "\"explanation\":\"MST complete with total cost " << cost << "\""
+        << "}";
+    trace::emit(out.str());
 }
 
 void printInit(const Graph& graph) {
@@ -67,27 +94,35 @@ void printInit(const Graph& graph) {
             nodes.insert(v);
         }
     }
-    cout << "{"
-         << "\"step\":" << STEP++ << ","
-         << "\"type\":\"init\","
-         << "\"nodes\":[";
+    ostringstream out;
+    out << "{"
+        << "\"step\":" << STEP++ << ","
+        << "\"type\":\"init\","
+        << "\"nodes\":[";
     int cnt = 0;
     for (int n : nodes) {
-        cout << n << (++cnt < (int)nodes.size() ? "," : "");
+        out << n << (++cnt < (int)nodes.size() ? "," : "");
     }
-    cout << "],\"edges\":[";
+    out << "],\"edges\":[";
     for (size_t i = 0; i < edges.size(); ++i) {
         auto& [u, v, w] = edges[i];
-        cout << "{\"from\":"<<u<<",\"to\":"<<v<<",\"weight\":"<<w<<"}"
-             << (i+1<edges.size()?"," : "");
+        out << "{\"from\":"<<u<<",\"to\":"<<v<<",\"weight\":"<<w<<"}"
+            << (i+1<edges.size()?"," : "");
     }
-    cout << "]}" << endl;
+    out << "]}";
+    trace::emit(out.str());
+}
+
+// One error line on stderr; the message may hold file paths or user input, so
+// it is escaped.
+void printError(const string& message) {
+    cerr << "{\"type\":\"error\",\"message\":" << jsonString(message) << "}" << endl;
 }
 
 Graph buildGraphFromArgs(int argc, char* argv[], int startIndex) {
     Graph graph;
     if ((argc - startIndex) % 3 != 0) {
-        cerr << "{\"type\":\"error\",\"message\":\"Invalid args: need u v w triplets\"}"<<endl;
+        printError("Invalid args: need u v w triplets");
         exit(1);
     }
     for (int i = startIndex; i+2<argc; i+=3) {
@@ -98,6 +133,24 @@ Graph buildGraphFromArgs(int argc, char* argv[], int startIndex) {
     return graph;
 }
 
+// Edges as u v w triplets from --stdin-format input.
+Graph buildGraphFromStdin(bulk::Format format) {
+    bulk::Input input = bulk::Input::readStdin();
+    vector<int> values;
+    if (format == bulk::Format::I32) values = bulk::decodeIntegers<int32_t>(input.bytes());
+    else if (format == bulk::Format::Text) values = bulk::parseNumbers<int>(input.bytes());
+    else throw invalid_argument("Edges on stdin must be i32 or text");
+    if (values.size() % 3 != 0) throw invalid_argument("Invalid input: need u v w triplets");
+
+    Graph graph;
+    for (size_t i = 0; i < values.size(); i += 3) {
+        int u = values[i], v = values[i + 1], w = values[i + 2];
+        graph[u].push_back({v, w});
+        graph[v].push_back({u, w});
+    }
+    return graph;
+}
+
 Graph buildDefaultGraph() {
     Graph g;
     g[0] = {{1,4},{2,1}};
@@ -107,55 +160,166 @@ Graph buildDefaultGraph() {
     return g;
 }
 
-void runDijkstra(const Graph& graph, int start=0, int end=3) {
+// Shortest path from start to end. The search stops as soon as end is
+// settled; with `bidirectional` it grows from both ends and stops when the
+// two frontiers can no longer improve on the best meeting point.
+void runDijkstra(const Graph& graph, int start, int end, bool bidirectional) {
     printInit(graph);
-    unordered_map<int,int> dist, prev;
-    unordered_set<int> vis;
-    for (auto& [n,_]: graph) dist[n] = numeric_limits<int>::max();
-    dist[start] = 0;
-    priority_queue<pair<int,int>,vector<pair<int,int>>,greater<>> pq;
-    pq.push({0,start});
+    sp::CsrGraph g = sp::CsrGraph::from(graph);
+    int s = g.find(start), t = g.find(end);
 
-    while (!pq.empty()) {
-        auto [d,u] = pq.top(); pq.pop();
-        printStep("choose", u, d,
-                  "Choosing node "+to_string(u)+" with dist="+to_string(d));           
+    sp::PathResult result;
+    if (s != -1 && t != -1) {
+        SelectedTracer<StreamTracer> tracer;
+        sp::Labels forward, backward;
+        result = bidirectional ? sp::bidirectionalDijkstra(g, s, t, forward, backward, tracer)
+                               : sp::dijkstra(g, s, t, forward, tracer);
+    }
 
-        if (d>dist[u]) {
-            printStep("skip",u,d,"Skipping stale entry for node "+to_string(u));   
-            continue;
-        }
-        if (vis.count(u)) {
-            printStep("skip",u,d,"Skipping already visited node "+to_string(u));   
-            continue;
-        }
-        vis.insert(u);
-        printStep("visit",u,d,"Visiting node "+to_string(u));        
+    if (result.cost == sp::kInf) {
+        trace::emit("{\"step\":"+to_string(STEP++)+",\"type\":\"final\",\"explanation\":\"No path to node "+to_string(end)+"\"}");
+        return;
+    }
+    printFinalPath(result.path, result.cost);
+}
 
-        for (auto& e: graph.at(u)) {
-            int v=e.to, w=e.weight;
-            printStep("consider", u, v,
-                      "Considering edge "+to_string(u)+"->"+to_string(v)+" (w="+to_string(w)+")"); 
-            if (dist[u]+w < dist[v]) {
-                dist[v]=dist[u]+w;
-                prev[v]=u;
-                pq.push({dist[v],v});
-                printStep("update",v,dist[v],
-                          "Updated dist["+to_string(v)+"]="+to_string(dist[v]));    
-            }
-        }
+// Dijkstra in session mode: the full shortest-path tree from start is kept
+// in `file`. When the next run has the same nodes and start, only the part
+// of the tree the edge changes affect is searched again; otherwise the tree
+// is rebuilt. Ends with the work done against a full search of the tree.
+void runDijkstraSession(const Graph& graph, int start, int end, const string& file) {
+    printInit(graph);
+    sp::CsrGraph g = sp::CsrGraph::from(graph);
+    int s = g.find(start), t = g.find(end);
+    if (s == -1 || t == -1) {
+        trace::emit("{\"step\":"+to_string(STEP++)+",\"type\":\"final\",\"explanation\":\"No path to node "+to_string(end)+"\"}");
+        return;
     }
 
-    vector<int> path;
-    int cur=end;
-    if (prev.find(cur)==prev.end() && cur!=start) {
-        cout << "{\"step\":"<<STEP++<<",\"type\":\"final\",\"explanation\":\"No path to node "<<end<<"\"}"<<endl;
+    SelectedTracer<StreamTracer> tracer;
+    sp::PathTree tree;
+    size_t settled = 0;
+    if (sp::PathTree::load(file, tree) && tree.graph.ids == g.ids && tree.source == s) {
+        vector<sp::EdgeChange> changes = sp::PathTree::diff(tree.graph, g);
+        settled = tree.repair(move(g), changes, tracer);
+    } else {
+        tree = sp::PathTree::build(move(g), s, tracer, settled);
+    }
+    if (!tree.save(file)) cerr << "Could not save session to " << file << endl;
+    session::reportWork("nodes", settled, tree.reachable());
+
+    sp::PathResult result = tree.path(t);
+    if (result.cost == sp::kInf) {
+        trace::emit("{\"step\":"+to_string(STEP++)+",\"type\":\"final\",\"explanation\":\"No path to node "+to_string(end)+"\"}");
         return;
     }
-    while(cur!=start){ path.push_back(cur); cur=prev[cur]; }
-    path.push_back(start);
-    reverse(path.begin(),path.end());
-    printFinalPath(path, dist[end]);
+    printFinalPath(result.path, result.cost);
+}
+
+// Distances from every source (default: every node) to every node, as
+// compressed tiles rather than steps (see all_pairs.h):
+//
+//   {"type":"matrix", "kernel", "nodes", "sources", "tile", "ids", "sourceIds"}
+//   {"type":"tile", "row", "col", "rows", "cols", "data"}     in any order
+//   {"type":"matrix-end", "tiles", "bytes", "rawBytes", "ms"}
+//
+// A tile's row and col index sourceIds and ids.
+void runAllPairs(const Graph& graph, const vector<int>& sourceIds, const string& kernel, unsigned threads) {
+    auto start = chrono::steady_clock::now();
+    sp::CsrGraph g = sp::CsrGraph::from(graph);
+    apsp::checkDistanceRange(g);
+    vector<int> sources;
+    if (sourceIds.empty()) {
+        for (int v = 0; v < g.size(); ++v) sources.push_back(v);
+    }
+    for (int id : sourceIds) {
+        int s = g.find(id);
+        if (s == -1) throw invalid_argument("Unknown source node " + to_string(id));
+        sources.push_back(s);
+    }
+
+    const char* chosen = apsp::chooseKernel(g, sources.size(), kernel);
+    ostringstream header;
+    header << "{\"step\":" << STEP++ << ",\"type\":\"matrix\",\"kernel\":\"" << chosen << "\",\"nodes\":" << g.size()
+           << ",\"sources\":" << sources.size() << ",\"tile\":" << apsp::kTile << ",\"ids\":[";
+    for (int v = 0; v < g.size(); ++v) header << (v ? "," : "") << g.ids[v];
+    header << "],\"sourceIds\":[";
+    for (size_t i = 0; i < sources.size(); ++i) header << (i ? "," : "") << g.ids[sources[i]];
+    header << "]}";
+    trace::emit(header.str());
+
+    // Tiles are encoded on the thread that computed them; only the hand-off
+    // to the trace writer is serialized.
+    mutex emitLock;
+    size_t tiles = 0, bytes = 0;
+    apsp::distances(g, sources, chosen, threads, [&](int row, int col, int rows, int cols, const int* data, size_t stride) {
+        string line = "{\"type\":\"tile\",\"row\":" + to_string(row) + ",\"col\":" + to_string(col) +
+                      ",\"rows\":" + to_string(rows) + ",\"cols\":" + to_string(cols) + ",\"data\":\"" +
+                      apsp::encodeTile(data, stride, rows, cols) + "\"}";
+        lock_guard<mutex> guard(emitLock);
+        trace::emit(line);
+        ++tiles;
+        bytes += line.size();
+    });
+
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    trace::emit("{\"step\":" + to_string(STEP++) + ",\"type\":\"matrix-end\",\"tiles\":" + to_string(tiles) +
+                ",\"bytes\":" + to_string(bytes) + ",\"rawBytes\":" + to_string(sources.size() * g.size() * 4) +
+                ",\"ms\":" + to_string(ms) + "}");
+}
+
+// Preprocessing: picks landmarks, computes their distances to every node and
+// saves them with the graph, so later alt-query runs skip both parsing the
+// graph and searching most of it.
+void runAltBuild(const Graph& graph, const string& file, int landmarks) {
+    auto start = chrono::steady_clock::now();
+    sp::AltIndex alt = sp::AltIndex::build(sp::CsrGraph::from(graph), landmarks);
+    alt.save(file);
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    ostringstream out;
+    out << "{"
+        << "\"step\":" << STEP++ << ","
+        << "\"type\":\"index\","
+        << "\"nodes\":" << alt.graph.size() << ","
+        << "\"edges\":" << alt.graph.targets.size() / 2 << ","
+        << "\"landmarks\":" << alt.landmarks.size() << ","
+        << "\"ms\":" << ms << ","
+        << "\"explanation\":\"Landmark index written to " << file << "\""
+        << "}";
+    trace::emit(out.str());
+}
+
+// Answers each (from, to) pair against a saved landmark index.
+void runAltQueries(const string& file, const vector<pair<int, int>>& queries) {
+    sp::AltIndex alt = sp::AltIndex::load(file);
+    sp::Labels labels;
+    NullTracer none;
+
+    for (auto [from, to] : queries) {
+        int s = alt.graph.find(from), t = alt.graph.find(to);
+        auto start = chrono::steady_clock::now();
+        sp::PathResult result;
+        if (s != -1 && t != -1) result = alt.query(s, t, labels, none);
+        double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+
+        ostringstream out;
+        out << "{"
+            << "\"step\":" << STEP++ << ","
+            << "\"type\":\"query\","
+            << "\"from\":" << from << ","
+            << "\"to\":" << to << ",";
+        if (result.cost == sp::kInf) {
+            out << "\"cost\":null,";
+        } else {
+            out << "\"path\":\"" << joinPath(result.path) << "\","
+                << "\"cost\":" << result.cost << ",";
+        }
+        out << "\"settled\":" << result.settled << ","
+            << "\"micros\":" << micros
+            << "}";
+        trace::emit(out.str());
+    }
 }
 
 void runPrims(const Graph& graph, int start=0) {
@@ -171,29 +335,25 @@ void runPrims(const Graph& graph, int start=0) {
 
     while(!pq.empty()) {
         auto [cost,u] = pq.top(); pq.pop();
-        printStep("choose", u, cost,
-                  "Choosing node "+to_string(u)+" with key="+to_string(cost));    
+        printStep("choose", u, cost, msg::Message(msg::PrimChoose, u, cost));
 
         if (inMST[u]) {
-            printStep("skip",u,cost,"Skipping node already in MST "+to_string(u)); 
+            printStep("skip",u,cost,msg::Message(msg::PrimSkip, u));
             continue;
         }
         inMST[u]=true;
         total+=cost;
         if (u!=start) mst.emplace_back(parent[u],u);
-        printStep("include",u,cost,
-                  "Include node "+to_string(u)+" with connecting cost="+to_string(cost)); 
+        printStep("include",u,cost,msg::Message(msg::PrimInclude, u, cost));
 
         for (auto& e: graph.at(u)) {
             int v=e.to, w=e.weight;
-            printStep("consider",u,v,
-                      "Considering edge "+to_string(u)+"->"+to_string(v)+" (w="+to_string(w)+")"); 
+            printStep("consider",u,v,msg::Message(msg::ConsiderEdge, u, v, w));
             if (!inMST[v] && w<key[v]) {
                 key[v]=w;
                 parent[v]=u;
                 pq.push({w,v});
-                printStep("update",v,w,
-                          "Update key["+to_string(v)+"]="+to_string(w));              
+                printStep("update",v,w,msg::Message(msg::PrimUpdate, v, w));
             }
         }
     }
@@ -234,44 +394,115 @@ void runKruskal(const Graph& graph) {
     vector<pair<int,int>> mst;
     int total=0;
     for (auto& [w,u,v]: edges) {
-        printStep("consider", u, v,
-                  "Considering edge "+to_string(u)+"-"+to_string(v)
-                  +" (w="+to_string(w)+")");                          
+        printStep("consider", u, v, msg::Message(msg::KruskalConsider, u, v, w));
         if (!dsu.unionSet(u,v)) {
-            printStep("skip",u,v,
-                      "Skipping edge "+to_string(u)+"-"+to_string(v)
-                      +" (would form cycle)");                        
+            printStep("skip",u,v,msg::Message(msg::KruskalSkip, u, v));
             continue;
         }
         total+=w;
         mst.emplace_back(u,v);
-        printStep("include",u,w,
-                  "Kruskal: include edge "+to_string(u)+"-"+to_string(v)
-                  +" (w="+to_string(w)+")");                           
+        printStep("include",u,w,msg::Message(msg::KruskalInclude, u, v, w));
     }
 
     printFinalMST(total, mst);
 }
 
 void printEnd() {
-    cout << "{\"step\":"<<STEP++<<",\"type\":\"end\"}" << endl;
+    trace::emit("{\"step\":"+to_string(STEP++)+",\"type\":\"end\"}");
 }
 
 int main(int argc, char* argv[]) {
-    if(argc<2) {
-        cerr << "{\"type\":\"error\",\"message\":\"Usage: <algo> [u v w ...]\"}"<<endl;
-        return 1;
-    }
-    string algo=argv[1];
-    Graph graph = (argc==2||(argc==3&&string(argv[2])=="0"))
-                  ? buildDefaultGraph()
-                  : buildGraphFromArgs(argc,argv,2);
-
-    if(algo=="dijkstra")     runDijkstra(graph,0,3);
-    else if(algo=="prims")   runPrims(graph);
-    else if(algo=="kruskal") runKruskal(graph);
-    else {
-        cerr << "{\"type\":\"error\",\"message\":\"Unknown algorithm: "<<algo<<"\"}"<<endl;
+    // Leading options:
+    //   --from=<node> --to=<node>   endpoints for dijkstra (default 0 and 3)
+    //   --bidirectional             search from both endpoints
+    //   --landmarks=<k>             landmarks for alt-build (default 8)
+    //   --session=<file>            dijkstra keeps its tree in <file> and
+    //                               repairs it on the next run (see
+    //                               session_state.h); implies one-way search
+    //   --sources=<id,id,...>       sources for all-pairs (default every node)
+    //   --kernel=<name>             all-pairs kernel: auto, dijkstra or
+    //                               floyd-warshall (default auto)
+    //   --threads=<n>               all-pairs threads (default and maximum one
+    //                               per core)
+    //   --stdin-format=i32|text     read the u v w edges from stdin
+    int from = 0, to = 3, landmarks = 8;
+    string sessionFile, kernel = "auto";
+    vector<int> sources;
+    const unsigned cores = max(1u, thread::hardware_concurrency());
+    unsigned threads = cores;
+    bulk::Format format = bulk::Format::None;
+    bool bidirectional = false;
+    // Bad option values throw; the catch at the end reports them.
+    try {
+        auto number = [](const string& option) {
+            try {
+                return stoi(option.substr(option.find('=') + 1));
+            } catch (const logic_error&) {
+                throw invalid_argument("Not a number: " + option);
+            }
+        };
+        int first = 1;
+        for (; first < argc && string(argv[first]).rfind("--", 0) == 0; ++first) {
+            string option = argv[first];
+            if (option.rfind("--from=", 0) == 0) from = number(option);
+            else if (option.rfind("--to=", 0) == 0) to = number(option);
+            else if (option.rfind("--landmarks=", 0) == 0) landmarks = number(option);
+            else if (option == "--bidirectional") bidirectional = true;
+            else if (session::parseSessionOption(option, sessionFile)) {}
+            else if (option.rfind("--sources=", 0) == 0) sources = bulk::parseNumbers<int>(option.substr(10));
+            else if (option.rfind("--kernel=", 0) == 0 && (option == "--kernel=auto" || option == "--kernel=dijkstra" ||
+                                                            option == "--kernel=floyd-warshall")) kernel = option.substr(9);
+            else if (option.rfind("--threads=", 0) == 0) threads = min<unsigned>(max(1, number(option)), cores);
+            else if (bulk::parseFormatOption(option, format)) {}
+            else {
+                printError("Unknown option " + option);
+                return 1;
+            }
+        }
+
+        if(argc<=first) {
+            printError("Usage: [options] <algo> [u v w ...] | alt-build <file> [u v w ...] | alt-query <file> [from to ...]");
+            return 1;
+        }
+        string algo=argv[first];
+        // alt-build and alt-query take the index file before their arguments.
+        bool usesIndex = algo=="alt-build" || algo=="alt-query";
+        if (usesIndex && argc<=first+1) {
+            printError(algo + " needs an index file");
+            return 1;
+        }
+        int argsAt = first + (usesIndex ? 2 : 1);
+
+        if (algo=="alt-query") {
+            if ((argc-argsAt)%2 != 0) {
+                printError("Invalid args: need from to pairs");
+                return 1;
+            }
+            vector<pair<int,int>> queries;
+            for (int i=argsAt; i+1<argc; i+=2) queries.emplace_back(stoi(argv[i]), stoi(argv[i+1]));
+            if (queries.empty()) queries.emplace_back(from, to);
+            runAltQueries(argv[first+1], queries);
+            printEnd();
+            return 0;
+        }
+
+        Graph graph = format != bulk::Format::None ? buildGraphFromStdin(format)
+                      : (argc==argsAt||(argc==argsAt+1&&string(argv[argsAt])=="0"))
+                      ? buildDefaultGraph()
+                      : buildGraphFromArgs(argc,argv,argsAt);
+
+        if(algo=="dijkstra" && !sessionFile.empty()) runDijkstraSession(graph,from,to,sessionFile);
+        else if(algo=="dijkstra")  runDijkstra(graph,from,to,bidirectional);
+        else if(algo=="prims")     runPrims(graph);
+        else if(algo=="kruskal")   runKruskal(graph);
+        else if(algo=="alt-build") runAltBuild(graph,argv[first+1],landmarks);
+        else if(algo=="all-pairs") runAllPairs(graph,sources,kernel,threads);
+        else {
+            printError("Unknown algorithm: " + algo);
+            return 1;
+        }
+    } catch (const exception& e) {
+        printError(e.what());
         return 1;
     }
 
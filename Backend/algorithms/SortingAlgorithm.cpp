@@ -3,245 +3,329 @@
 #include <string>
 #include <sstream>
 #include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <stdexcept>
+#include "trace_writer.h"
+#include "trace_line.h"
+#include "step_session.h"
+#include "batch.h"
+#include "bulk_input.h"
+#include "sorting.h"
 
 using namespace std;
 
-void printStep(const vector<int>& arr, const string& message, int depth, int position, const string& action, int pivotIndex = -1, int swapA = -1, int swapB = -1) {
-    cout << "{";
-    cout << "\"array\": [";
-    for (int i = 0; i < arr.size(); ++i) {
-        cout << arr[i];
-        if (i < arr.size() - 1) cout << ", ";
-    }
-    cout << "], ";
-    cout << "\"message\": \"" << message << "\", ";
-    cout << "\"depth\": " << depth << ", ";
-    cout << "\"position\": " << position << ", ";
-    cout << "\"action\": \"" << action << "\", ";
-    cout << "\"pivotIndex\": " << pivotIndex << ", ";
-    cout << "\"swap\": [" << swapA << ", " << swapB << "]";
-    cout << "}" << endl;
-}
-
-void quickSort(vector<int>& arr, int low, int high, int depth, int position) {
-    if (low >= high) {
-        if (low == high) {
-            printStep(arr, "Single element, no need to sort", depth, position, "base");
-        }
-        return;
+// JSON text for one array element: numbers as-is, strings quoted.
+void writeValue(ostringstream& out, string_view value) {
+    out << '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') out << '\\' << c;
+        else if ((unsigned char)c < 0x20) out << ' ';
+        else out << c;
     }
+    out << '"';
+}
 
-    int pivot = arr[high];
-    int i = low - 1;
-
-    printStep(arr, "Selecting pivot " + to_string(pivot) + " at index " + to_string(high), depth, position, "pivot", high);
-
-    for (int j = low; j < high; ++j) {
-        if (arr[j] <= pivot) {
-            ++i;
-            if (i != j) {
-                swap(arr[i], arr[j]);
-                printStep(arr, "Swapping " + to_string(arr[i]) + " and " + to_string(arr[j]), depth, position, "swap", high, i, j);
-            }
-        }
-    }
+template <class T>
+void writeValue(ostringstream& out, const T& value) {
+    out << value;
+}
 
-    swap(arr[i + 1], arr[high]);
-    printStep(arr, "Placing pivot at correct position", depth, position, "pivot-swap", i + 1, high);
+// Appends one step to `line`. Steps are formatted for every element of every
+// traced array, so this goes through trace::Line rather than a stream and
+// allocates nothing once the line buffer has grown.
+template <class Range>
+void writeStep(trace::Line& line, const Range& arr, const msg::Message& message, int depth, int position, const char* action, int pivotIndex = -1, int swapA = -1, int swapB = -1) {
+    line.raw("{\"array\": ").array(arr).raw(", ");
+    line.message(message).raw(", ");
+    line.raw("\"depth\": ").number(depth).raw(", ");
+    line.raw("\"position\": ").number(position).raw(", ");
+    line.raw("\"action\": \"").raw(action).raw("\", ");
+    line.raw("\"pivotIndex\": ").number(pivotIndex).raw(", ");
+    line.raw("\"swap\": [").number(swapA).raw(", ").number(swapB).raw("]}");
+}
 
-    int pivotIndex = i + 1;
-    quickSort(arr, low, pivotIndex - 1, depth + 1, position * 2);
-    quickSort(arr, pivotIndex + 1, high, depth + 1, position * 2 + 1);
+template <class T>
+void printStep(const vector<T>& arr, const msg::Message& message, int depth, int position, const char* action, int pivotIndex = -1, int swapA = -1, int swapB = -1) {
+    static trace::Line line;
+    writeStep(line, arr, message, depth, position, action, pivotIndex, swapA, swapB);
+    line.emit();
 }
 
-void merge(vector<int>& arr, int left, int mid, int right, int depth, int position) {
-    vector<int> leftArr(arr.begin() + left, arr.begin() + mid + 1);
-    vector<int> rightArr(arr.begin() + mid + 1, arr.begin() + right + 1);
+template <class T>
+void printStep(const vector<T>& arr, const SortStep& step) {
+    printStep(arr, step.message, step.depth, step.position, step.action, step.pivotIndex, step.swapA, step.swapB);
+}
 
-    int i = 0, j = 0, k = left;
+// Streams every step to the visualizer.
+struct StreamTracer {
+    static constexpr bool enabled = true;
+    trace::Line line;
 
-    while (i < (int)leftArr.size() && j < (int)rightArr.size()) {
-        if (leftArr[i] <= rightArr[j]) arr[k++] = leftArr[i++];
-        else arr[k++] = rightArr[j++];
+    template <class Range>
+    void step(const Range& arr, const msg::Message& message, int depth, int position, const char* action,
+              int pivotIndex = -1, int swapA = -1, int swapB = -1) {
+        writeStep(line, arr, message, depth, position, action, pivotIndex, swapA, swapB);
+        line.emit();
+    }
+};
+
+// Collects the steps of one batch input instead of streaming them.
+struct BufferedTracer {
+    static constexpr bool enabled = true;
+    StepBuffer& steps;
+    trace::Line line;
+
+    template <class Range>
+    void step(const Range& arr, const msg::Message& message, int depth, int position, const char* action,
+              int pivotIndex = -1, int swapA = -1, int swapB = -1) {
+        writeStep(line, arr, message, depth, position, action, pivotIndex, swapA, swapB);
+        steps.add(line.view());
+        line.clear();
+    }
+};
+
+template <class T>
+string formatArray(const vector<T>& arr) {
+    ostringstream out;
+    out.precision(17);
+    out << "[";
+    for (size_t i = 0; i < arr.size(); ++i) {
+        if (i) out << ", ";
+        writeValue(out, arr[i]);
     }
+    out << "]";
+    return out.str();
+}
 
-    while (i < (int)leftArr.size()) arr[k++] = leftArr[i++];
-    while (j < (int)rightArr.size()) arr[k++] = rightArr[j++];
+template <class T>
+T parseValue(const char* text);
 
-    vector<int> merged(arr.begin() + left, arr.begin() + right + 1);
-    printStep(merged, "Merged from " + to_string(left) + " to " + to_string(right), depth, position, "merge");
-}
+template <>
+int parseValue<int>(const char* text) { return bulk::parseNumber<int>(text); }
 
-void mergeSort(vector<int>& arr, int left, int right, int depth, int position) {
-    if (left == right) {
-        vector<int> singleElement = { arr[left] };
-        printStep(singleElement, "An array of length 1 cannot be split, ready for merge", depth, position, "base");
-        return;
-    }
+template <>
+int64_t parseValue<int64_t>(const char* text) { return bulk::parseNumber<int64_t>(text); }
 
-    int mid = left + (right - left) / 2;
+template <>
+double parseValue<double>(const char* text) { return bulk::parseNumber<double>(text); }
 
-    vector<int> current(arr.begin() + left, arr.begin() + right + 1);
-    printStep(current, "Splitting", depth, position, "split");
+template <>
+string parseValue<string>(const char* text) { return text; }
 
-    mergeSort(arr, left, mid, depth + 1, position * 2);
-    mergeSort(arr, mid + 1, right, depth + 1, position * 2 + 1);
-    merge(arr, left, mid, right, depth, position);
+template <class T>
+vector<T> parseInput(int argc, char* argv[], int startIndex) {
+    vector<T> arr;
+    for (int i = startIndex; i < argc; ++i) {
+        arr.push_back(parseValue<T>(argv[i]));
+    }
+    return arr;
 }
 
-void bubbleSort(vector<int>& arr) {
-    int n = arr.size();
-    for (int i = 0; i < n - 1; ++i) {
-        for (int j = 0; j < n - i - 1; ++j) {
-            printStep(arr, "Comparing " + to_string(arr[j]) + " and " + to_string(arr[j + 1]),
-                      1, i * n + j, "compare", -1, j, j + 1);
-
-            if (arr[j] > arr[j + 1]) {
-                swap(arr[j], arr[j + 1]);
-                printStep(arr, "Swapping " + to_string(arr[j]) + " and " + to_string(arr[j + 1]),
-                          1, i * n + j, "swap", -1, j, j + 1);
-            } else {
-                printStep(arr, "No swap needed", 1, i * n + j, "no-swap", -1, j, j + 1);
-            }
-        }
-    }
+const string kSortAlgorithms[] = {
+    "merge-sort", "quick-sort", "bubble-sort", "selection-sort", "insertion-sort",
+    "counting-sort", "radix-sort", "msd-radix-sort", "multikey-quicksort", "lcp-merge-sort",
+};
+
+bool isSortAlgorithm(const string& algorithm) {
+    return find(begin(kSortAlgorithms), end(kSortAlgorithms), algorithm) != end(kSortAlgorithms);
 }
 
+// Sorts arr with `algorithm`, reporting steps to `tracer`. Returns an error
+// message if the algorithm cannot sort elements of type T, otherwise "".
+template <class T, class Tracer>
+string sortWith(const string& algorithm, vector<T>& arr, Tracer& tracer) {
+    if (arr.empty()) return "";
 
-void selectionSort(vector<int>& arr) {
-    int n = arr.size();
-    for (int i = 0; i < n - 1; ++i) {
-        int minIdx = i;
-        for (int j = i + 1; j < n; ++j) {
-            printStep(arr, "Comparing " + to_string(arr[j]) + " with current min " + to_string(arr[minIdx]), 1, 0, "compare", -1, j, minIdx);
-            if (arr[j] < arr[minIdx]) {
-                minIdx = j;
+    if (algorithm == "merge-sort") {
+        mergeSort(arr, 0, arr.size() - 1, 1, 0, tracer);
+    } else if (algorithm == "quick-sort") {
+        quickSort(arr, 0, arr.size() - 1, 1, 0, tracer);
+    } else if (algorithm == "bubble-sort") {
+        bubbleSort(arr, tracer);
+    } else if (algorithm == "selection-sort") {
+        selectionSort(arr, tracer);
+    } else if (algorithm == "insertion-sort") {
+        insertionSort(arr, tracer);
+    } else if (algorithm == "counting-sort" || algorithm == "radix-sort") {
+        if constexpr (is_integral_v<T>) {
+            auto [minVal, maxVal] = minmax_element(arr.begin(), arr.end());
+            if (*minVal < 0) return algorithm + " needs non-negative keys.";
+            if (algorithm == "counting-sort" && (int64_t)*maxVal > kMaxCountingKey) {
+                return "counting-sort needs keys up to " + to_string(kMaxCountingKey) + "; use radix-sort for larger ones.";
             }
+            if (algorithm == "counting-sort") countingSort(arr, 1, 0, tracer);
+            else radixSort(arr, 1, 0, tracer);
+        } else {
+            return algorithm + " needs integer input.";
         }
-        if (minIdx != i) {
-            swap(arr[i], arr[minIdx]);
-            printStep(arr, "Swapping " + to_string(arr[i]) + " and " + to_string(arr[minIdx]), 1, 0, "swap", -1, i, minIdx);
-        }
-    }
-}
-void insertionSort(vector<int>& arr) {
-    int n = arr.size();
-    for (int i = 1; i < n; ++i) {
-        int key = arr[i];
-        int j = i - 1;
-
-        while (j >= 0 && arr[j] > key) {
-            arr[j + 1] = arr[j];
-            printStep(arr, "Shifting " + to_string(arr[j]) + " to right", 1, i, "shift", -1, j, j + 1);
-            j--;
+    } else if (algorithm == "msd-radix-sort" || algorithm == "multikey-quicksort" || algorithm == "lcp-merge-sort") {
+        if constexpr (is_convertible_v<const T&, string_view>) {
+            if (algorithm == "msd-radix-sort") strsort::msdRadixSort(arr, tracer);
+            else if (algorithm == "multikey-quicksort") strsort::multikeyQuicksort(arr, tracer);
+            else strsort::lcpMergeSort(arr, tracer);
+        } else {
+            return algorithm + " needs string input (--type=string).";
         }
-        arr[j + 1] = key;
-        printStep(arr, "Inserting " + to_string(key) + " at position " + to_string(j + 1), 1, i, "insert", -1);
     }
+    return "";
 }
 
-void countingSort(vector<int>& arr, int depth, int position) {
-    int maxVal = *max_element(arr.begin(), arr.end());
-    vector<int> count(maxVal + 1, 0);
-    vector<int> output(arr.size());
-
-    for (int i = 0; i < arr.size(); i++) {
-        count[arr[i]]++;
-        printStep(arr, "Counting element " + to_string(arr[i]), depth, position, "count", -1, arr[i], -1);
+// Every step carries the whole array, so the output of a traced sort grows
+// with the number of steps times the length. Arrays longer than `traceLimit`
+// are sorted untraced: only the initial and the final array are written.
+template <class T>
+int runSort(const string& algorithm, vector<T> arr, bool stepMode, size_t traceLimit) {
+    printStep(arr, msg::Message(msg::InitialArray), 0, 0, "initial");
+    if (arr.empty()) return 0;
+
+    if (!isSortAlgorithm(algorithm)) {
+        // Unknown algorithm: echo the input back unchanged.
+        printStep(arr, msg::Message(msg::FinalArray), 0, 0, "final");
+        return 0;
     }
 
-    for (int i = 1; i <= maxVal; i++) {
-        count[i] += count[i - 1];
-        printStep(arr, "Building prefix sum at index " + to_string(i), depth, position, "prefix", -1, i, -1);
+    if (arr.size() > traceLimit) {
+        NullTracer none;
+        string error = sortWith(algorithm, arr, none);
+        if (!error.empty()) {
+            cerr << error << "\n";
+            return 1;
+        }
+        printStep(arr, msg::Message(msg::FinalArray), 0, 0, "final");
+        return 0;
     }
 
-    for (int i = arr.size() - 1; i >= 0; i--) {
-        output[count[arr[i]] - 1] = arr[i];
-        count[arr[i]]--;
-        printStep(output, "Placing " + to_string(arr[i]) + " at correct position", depth, position, "place", -1, count[arr[i]], i);
+    if (stepMode && algorithm == "bubble-sort") {
+        auto steps = bubbleSortSteps(arr);
+        serveSteps(steps, [&](const SortStep& step) { printStep(arr, step); });
+        return 0;
     }
 
-    arr = output;
+    SelectedTracer<StreamTracer> tracer;
+    string error = sortWith(algorithm, arr, tracer);
+    if (!error.empty()) {
+        cerr << error << "\n";
+        return 1;
+    }
+    return 0;
 }
 
-int getDigit(int num, int exp) {
-    return (num / exp) % 10;
+// --stdin-format: the elements come from stdin instead of the command line
+// (see bulk_input.h). i32 and i64 decide the element type themselves; text
+// holds numbers of --type, and utf8 (or text with --type=string) one string
+// per line, sorted as views into the input.
+int runSortStdin(const string& algorithm, bulk::Format format, const string& type, size_t traceLimit) {
+    try {
+        bulk::Input input = bulk::Input::readStdin();
+        string_view bytes = input.bytes();
+        if (format == bulk::Format::I32) return runSort(algorithm, bulk::decodeIntegers<int32_t>(bytes), false, traceLimit);
+        if (format == bulk::Format::I64) return runSort(algorithm, bulk::decodeIntegers<int64_t>(bytes), false, traceLimit);
+        if (format == bulk::Format::Utf8 || type == "string") return runSort(algorithm, bulk::splitLines(bytes), false, traceLimit);
+        if (type == "int") return runSort(algorithm, bulk::parseNumbers<int>(bytes), false, traceLimit);
+        if (type == "int64") return runSort(algorithm, bulk::parseNumbers<int64_t>(bytes), false, traceLimit);
+        if (type == "double") return runSort(algorithm, bulk::parseNumbers<double>(bytes), false, traceLimit);
+    } catch (const exception& e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+    cerr << "Unknown element type " << type << "\n";
+    return 1;
 }
 
-void radixSort(vector<int>& arr, int depth, int position) {
-    int maxVal = *max_element(arr.begin(), arr.end());
-    int exp = 1;
-
-    while (maxVal / exp > 0) {
-        vector<int> output(arr.size());
-        vector<int> count(10, 0);
-
-        for (int i = 0; i < arr.size(); i++) {
-            int digit = getDigit(arr[i], exp);
-            count[digit]++;
-            printStep(arr, to_string(arr[i]) + " has digit " + to_string(digit) + " at exp " + to_string(exp), depth, position, "digit", -1, digit, i);
+// One input per stdin line, elements separated by tabs; each frame's result
+// is the sorted array.
+template <class T>
+int runSortBatch(const string& algorithm, const BatchOptions& batch) {
+    if (!isSortAlgorithm(algorithm)) {
+        cerr << "Unknown algorithm " << algorithm << "\n";
+        return 1;
+    }
+    return runBatch(batch, [&](const vector<string>& fields, StepBuffer* steps) {
+        vector<T> arr;
+        arr.reserve(fields.size());
+        for (const string& field : fields) {
+            try {
+                arr.push_back(parseValue<T>(field.c_str()));
+            } catch (const logic_error&) {
+                throw invalid_argument("not a valid element: " + field);
+            }
         }
 
-        for (int i = 1; i < 10; i++) {
-            count[i] += count[i - 1];
-            printStep(arr, "Building prefix sum for digit " + to_string(i), depth, position, "prefix", -1, i, -1);
+        string error;
+        if (steps) {
+            BufferedTracer tracer{*steps, {}};
+            error = sortWith(algorithm, arr, tracer);
+        } else {
+            NullTracer tracer;
+            error = sortWith(algorithm, arr, tracer);
         }
+        if (!error.empty()) throw invalid_argument(error);
+        return formatArray(arr);
+    });
+}
 
-        for (int i = arr.size() - 1; i >= 0; i--) {
-            int digit = getDigit(arr[i], exp);
-            output[count[digit] - 1] = arr[i];
-            count[digit]--;
-            printStep(output, "Placing " + to_string(arr[i]) + " based on digit " + to_string(digit), depth, position, "place", -1, count[digit], i);
+int main(int argc, char* argv[]) {
+    // Leading options:
+    //   --step           advance only as far as the client asks (see step_session.h)
+    //   --type=<type>    element type: int (default), int64, double or string
+    //   --batch, --batch-traces, --threads=<n>   read many inputs from stdin (see batch.h)
+    //   --stdin-format=<f>   read one large input from stdin (see bulk_input.h)
+    //   --trace-limit=<n>    trace only arrays of at most n elements (default: all)
+    bool stepMode = false;
+    size_t traceLimit = SIZE_MAX;
+    BatchOptions batch;
+    bulk::Format format = bulk::Format::None;
+    string type = "int";
+    int first = 1;
+    try {
+        for (; first < argc && string(argv[first]).rfind("--", 0) == 0; ++first) {
+            string option = argv[first];
+            if (option == "--step") stepMode = true;
+            else if (option.rfind("--type=", 0) == 0) type = option.substr(7);
+            else if (option.rfind("--trace-limit=", 0) == 0) traceLimit = bulk::parseNumber<size_t>(option.substr(14));
+            else if (!parseBatchOption(option, batch) && !bulk::parseFormatOption(option, format)) {
+                cerr << "Unknown option " << option << "\n";
+                return 1;
+            }
         }
-
-        arr = output;
-        exp *= 10;
+    } catch (const exception& e) {
+        cerr << e.what() << "\n";
+        return 1;
     }
-}
-
-
-
-
-vector<int> parseInput(int argc, char* argv[], int startIndex) {
-    vector<int> arr;
-    for (int i = startIndex; i < argc; ++i) {
-        arr.push_back(stoi(argv[i]));
+    // All three of these read stdin.
+    if (format != bulk::Format::None && (stepMode || batch.enabled)) {
+        cerr << "--stdin-format cannot be combined with --step or --batch.\n";
+        return 1;
     }
-    return arr;
-}
 
-int main(int argc, char* argv[]) {
-    if (argc < 2) {
+    if (argc <= first) {
         cerr << "Algorithm name required.\n";
         return 1;
     }
 
-    string algorithm = argv[1];
-    vector<int> arr;
-
-    if (argc > 2) arr = parseInput(argc, argv, 2);
-    else arr = { 7, 8, 9, 4, 80, 60, 78, 49 }; // default
-
-    printStep(arr, "Initial array", 0, 0, "initial");
-
-    if (algorithm == "merge-sort") {
-        mergeSort(arr, 0, arr.size() - 1, 1, 0);
-    } else if (algorithm == "quick-sort") {
-        quickSort(arr, 0, arr.size() - 1, 1, 0);
-    } else if (algorithm == "bubble-sort") {
-        bubbleSort(arr);
-    } else if (algorithm == "selection-sort") {
-        selectionSort(arr);
-    } else if (algorithm == "insertion-sort") {
-        insertionSort(arr);
-    }  else if (algorithm == "counting-sort") {
-        countingSort(arr, 1, 0);
-    } else if (algorithm == "radix-sort") {
-        radixSort(arr, 1, 0);
-    } else {
-
-    printStep(arr, "Final sorted array", 0, 0, "final");
+    string algorithm = argv[first];
+    bool hasInput = argc > first + 1;
+
+    if (format != bulk::Format::None) {
+        return runSortStdin(algorithm, format, type, traceLimit);
+    } else if (batch.enabled) {
+        if (type == "int") return runSortBatch<int>(algorithm, batch);
+        if (type == "int64") return runSortBatch<int64_t>(algorithm, batch);
+        if (type == "double") return runSortBatch<double>(algorithm, batch);
+        if (type == "string") return runSortBatch<string>(algorithm, batch);
+    } else if (type == "int") {
+        vector<int> arr = hasInput ? parseInput<int>(argc, argv, first + 1)
+                                   : vector<int>{ 7, 8, 9, 4, 80, 60, 78, 49 }; // default
+        return runSort(algorithm, move(arr), stepMode, traceLimit);
+    } else if (type == "int64") {
+        return runSort(algorithm, parseInput<int64_t>(argc, argv, first + 1), stepMode, traceLimit);
+    } else if (type == "double") {
+        return runSort(algorithm, parseInput<double>(argc, argv, first + 1), stepMode, traceLimit);
+    } else if (type == "string") {
+        return runSort(algorithm, parseInput<string>(argc, argv, first + 1), stepMode, traceLimit);
+    }
 
-    return 0;
-}
+    cerr << "Unknown element type " << type << "\n";
+    return 1;
 }
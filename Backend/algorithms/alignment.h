@@ -0,0 +1,378 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "tracer.h"
+
+// Pairwise sequence alignment scores: edit distance, longest common
+// subsequence and Smith-Waterman local alignment.
+//
+// All three fill the same table with one recurrence, written in max form:
+//
+//   H[i][j] = max(H[i-1][j-1] + (a[i-1] == b[j-1] ? match : mismatch),
+//                 max(H[i-1][j], H[i][j-1]) + gap)         (and >= 0 if local)
+//
+// Edit distance is the negated table (match 0, mismatch -1, gap -1), LCS
+// counts matches (1, 0, 0), Smith-Waterman takes the best cell anywhere.
+//
+// Every kernel keeps O(len(a) + len(b)) memory: only scores are produced, never
+// the full table or an alignment, so 100k x 100k inputs fit easily. Kernels:
+//
+//   rows          two rows, one cell at a time; the only traced kernel
+//   diagonal      anti-diagonals, whose cells are independent, 8 at a time
+//                 with vector instructions
+//   bit-parallel  Myers / Hyyro bit-vector edit distance and LCS: 64 cells
+//                 of a column per word operation (not for local alignment)
+//   tiled         the table in square tiles that stay in cache; with more
+//                 than one thread, tiles on the same anti-diagonal of the tile
+//                 grid run in parallel (a wavefront)
+namespace align {
+
+enum class Mode { Edit, Lcs, Local };
+
+struct Scoring {
+    Mode mode;
+    int match, mismatch, gap;
+
+    static Scoring of(Mode mode) {
+        switch (mode) {
+            case Mode::Edit: return {mode, 0, -1, -1};
+            case Mode::Lcs: return {mode, 1, 0, 0};
+            default: return {mode, 2, -1, -1};
+        }
+    }
+    bool local() const { return mode == Mode::Local; }
+    // H[i][0] and H[0][i].
+    int boundary(int i) const { return local() ? 0 : i * gap; }
+    // Table value as the caller thinks of it (a distance for edit distance).
+    long long report(long long h) const { return mode == Mode::Edit ? -h : h; }
+};
+
+struct Result {
+    long long score;
+    const char* kernel;
+};
+
+// Traced reference kernel. Reports every cell with the row it belongs to, in
+// the knapsack-style dpRow format the DP visualizer draws.
+template <class Tracer>
+long long rowsScore(std::string_view a, std::string_view b, const Scoring& sc, Tracer& trace) {
+    int n = a.size(), m = b.size();
+    std::vector<int> prev(m + 1), cur(m + 1), shown;
+    for (int j = 0; j <= m; ++j) prev[j] = sc.boundary(j);
+    int best = 0;
+
+    auto show = [&](const std::vector<int>& row) -> const std::vector<int>& {
+        if constexpr (Tracer::enabled) {
+            shown.resize(row.size());
+            for (size_t j = 0; j < row.size(); ++j) shown[j] = (int)sc.report(row[j]);
+        }
+        return shown;
+    };
+    trace.step(0, 0, "init", (int)sc.report(prev[0]), show(prev));
+
+    for (int i = 1; i <= n; ++i) {
+        cur[0] = sc.boundary(i);
+        for (int j = 1; j <= m; ++j) {
+            bool eq = a[i - 1] == b[j - 1];
+            int diag = prev[j - 1] + (eq ? sc.match : sc.mismatch);
+            int up = prev[j] + sc.gap, left = cur[j - 1] + sc.gap;
+            int h = std::max(diag, std::max(up, left));
+            const char* decision = h == diag ? (eq ? "match" : "substitute") : h == up ? "delete" : "insert";
+            if (sc.local() && h <= 0) {
+                h = 0;
+                decision = "restart";
+            }
+            cur[j] = h;
+            best = std::max(best, h);
+            trace.step(i, j, decision, (int)sc.report(h), show(cur));
+        }
+        std::swap(prev, cur);
+    }
+    return sc.report(sc.local() ? best : prev[m]);
+}
+
+#if defined(__GNUC__)
+// Eight int32 lanes; UnalignedLanes reads and writes them at any int32
+// address.
+using Lanes = int32_t __attribute__((vector_size(32)));
+using UnalignedLanes = int32_t __attribute__((vector_size(32), aligned(4)));
+constexpr int kLanes = 8;
+#endif
+
+// Anti-diagonal kernel over one block of the table: the h x w cells below
+// `top` (the row above the block, top[0] being the corner) and right of `left`
+// (the column to its left, left[0] == top[0]). Writes the block's last row to
+// `bottom` and last column to `right`, in the same layout, and returns the
+// best cell for local alignment.
+//
+// Diagonal d holds the cells with i + j = d, indexed by i; each depends only
+// on diagonals d - 1 and d - 2, so a whole run of them is computed with vector
+// instructions. ai is a as ints, rb is b as ints in reverse, so that the
+// characters of b are contiguous along a diagonal too. Baseline x86-64 has no
+// vector max, so an AVX2 clone is also compiled and picked at load time.
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(__clang__)
+__attribute__((target_clones("avx2", "default")))
+#endif
+inline int diagonalBlock(const int32_t* ai, int h, const int32_t* rb, int w, const Scoring& sc,
+                         const int32_t* top, const int32_t* left, int32_t* bottom, int32_t* right,
+                         std::vector<int32_t>& scratch) {
+    scratch.resize(3 * (size_t)(h + 1));
+    int32_t *d2 = scratch.data(), *d1 = d2 + h + 1, *d0 = d1 + h + 1;
+    int best = 0;
+
+    for (int d = 0; d <= h + w; ++d) {
+        if (d <= w) d0[0] = top[d];
+        if (d <= h) d0[d] = left[d];
+        int first = std::max(1, d - w), last = std::min(h, d - 1);
+        int shift = w - d;   // rb[shift + i] = b[d - i - 1]
+
+        int i = first;
+#if defined(__GNUC__)
+        const Lanes match = Lanes{} + sc.match, mismatch = Lanes{} + sc.mismatch, gap = Lanes{} + sc.gap;
+        Lanes bestLanes = Lanes{};
+        auto at = [](const int32_t* p) -> const UnalignedLanes& { return *reinterpret_cast<const UnalignedLanes*>(p); };
+        for (; i + kLanes - 1 <= last; i += kLanes) {
+            Lanes diag = at(d2 + i - 1) + (at(ai + i - 1) == at(rb + shift + i) ? match : mismatch);
+            Lanes up = at(d1 + i), left = at(d1 + i - 1);
+            Lanes v = (up > left ? up : left) + gap;
+            v = diag > v ? diag : v;
+            if (sc.local()) {
+                v = v > 0 ? v : Lanes{};
+                bestLanes = bestLanes > v ? bestLanes : v;
+            }
+            *reinterpret_cast<UnalignedLanes*>(d0 + i) = v;
+        }
+        for (int k = 0; k < kLanes; ++k) best = std::max(best, (int)bestLanes[k]);
+#endif
+        for (; i <= last; ++i) {
+            int diag = d2[i - 1] + (ai[i - 1] == rb[shift + i] ? sc.match : sc.mismatch);
+            int v = std::max(diag, std::max(d1[i - 1], d1[i]) + sc.gap);
+            if (sc.local()) {
+                v = std::max(v, 0);
+                best = std::max(best, v);
+            }
+            d0[i] = v;
+        }
+        if (d >= h) bottom[d - h] = d0[h];
+        if (d >= w) right[d - w] = d0[d - w];
+        int32_t* oldest = d2;
+        d2 = d1;
+        d1 = d0;
+        d0 = oldest;
+    }
+    return best;
+}
+
+inline long long diagonalScore(std::string_view a, std::string_view b, const Scoring& sc) {
+    int n = a.size(), m = b.size();
+    std::vector<int32_t> ai(a.begin(), a.end()), rb(b.rbegin(), b.rend());
+    std::vector<int32_t> top(m + 1), left(n + 1), bottom(m + 1), right(n + 1), scratch;
+    for (int j = 0; j <= m; ++j) top[j] = sc.boundary(j);
+    for (int i = 0; i <= n; ++i) left[i] = sc.boundary(i);
+    int best = diagonalBlock(ai.data(), n, rb.data(), m, sc, top.data(), left.data(), bottom.data(), right.data(), scratch);
+    return sc.report(sc.local() ? best : bottom[m]);
+}
+
+// Bit-parallel kernels. The pattern's rows are split into 64-row words;
+// bit k of word w describes row 64w + k + 1 of the current column, and each
+// text character updates a whole word with a handful of operations.
+struct PatternMasks {
+    int words;
+    std::vector<uint64_t> peq;   // peq[c * words + w]: rows of word w holding c
+
+    explicit PatternMasks(std::string_view pattern) : words((pattern.size() + 63) / 64), peq(256 * (size_t)words) {
+        for (size_t i = 0; i < pattern.size(); ++i) {
+            peq[(unsigned char)pattern[i] * (size_t)words + i / 64] |= uint64_t(1) << (i % 64);
+        }
+    }
+    const uint64_t* of(char c) const { return &peq[(unsigned char)c * (size_t)words]; }
+};
+
+// Myers' algorithm in Hyyro's formulation: Pv / Mv mark rows where the value
+// rises / falls by one going down the column. Each word passes the change of
+// its last row on to the word below as that word's incoming horizontal delta;
+// the first word always gets +1, since row 0 grows by one per column in
+// global edit distance. Rows past the pattern in the last word only ever
+// affect higher bits, so they are left as they are.
+inline long long myersEditDistance(std::string_view pattern, std::string_view text) {
+    int m = pattern.size();
+    if (m == 0) return text.size();
+    PatternMasks masks(pattern);
+    int words = masks.words;
+    std::vector<uint64_t> pv(words, ~uint64_t(0)), mv(words, 0);
+    const uint64_t top = uint64_t(1) << 63, last = uint64_t(1) << ((m - 1) % 64);
+    long long score = m;
+    for (char ch : text) {
+        const uint64_t* peq = masks.of(ch);
+        int hin = 1;
+        for (int w = 0; w < words; ++w) {
+            uint64_t p = pv[w], n = mv[w], eq = peq[w];
+            uint64_t xv = eq | n;
+            if (hin < 0) eq |= 1;
+            uint64_t xh = (((eq & p) + p) ^ p) | eq;
+            uint64_t ph = n | ~(xh | p);
+            uint64_t mh = p & xh;
+            uint64_t high = w + 1 < words ? top : last;
+            int hout = (ph & high) ? 1 : (mh & high) ? -1 : 0;
+            ph <<= 1;
+            mh <<= 1;
+            if (hin < 0) mh |= 1;
+            else if (hin > 0) ph |= 1;
+            pv[w] = mh | ~(xv | ph);
+            mv[w] = ph & xv;
+            hin = hout;
+        }
+        score += hin;
+    }
+    return score;
+}
+
+// Bit-parallel LCS (Allison-Dix, Hyyro): zero bits of V mark the rows where
+// the column's LCS value steps up. V + U and V - U are multi-word, so the
+// carry and borrow run from each word into the next.
+inline long long bitParallelLcs(std::string_view pattern, std::string_view text) {
+    int m = pattern.size();
+    if (m == 0) return 0;
+    PatternMasks masks(pattern);
+    int words = masks.words;
+    std::vector<uint64_t> v(words, ~uint64_t(0));
+    for (char ch : text) {
+        const uint64_t* peq = masks.of(ch);
+        uint64_t carry = 0, borrow = 0;
+        for (int w = 0; w < words; ++w) {
+            uint64_t x = v[w], u = x & peq[w];
+            uint64_t sum = x + u;
+            uint64_t carryOut = sum < x;
+            sum += carry;
+            carryOut |= sum < carry;
+            uint64_t diff = x - u;
+            uint64_t borrowOut = x < u;
+            borrowOut |= diff < borrow;
+            diff -= borrow;
+            v[w] = sum | diff;
+            carry = carryOut;
+            borrow = borrowOut;
+        }
+    }
+    long long steps = 0;
+    for (int w = 0; w < words; ++w) {
+        uint64_t mask = w + 1 < words || m % 64 == 0 ? ~uint64_t(0) : (uint64_t(1) << (m % 64)) - 1;
+        steps += std::popcount(~v[w] & mask);
+    }
+    return steps;
+}
+
+// Tiled kernel. Between tiles only their edges are kept: the bottom row of
+// the last tile computed in each column band (hEdge), the right column of the
+// last tile in each row band (vEdge), and the value at every tile corner.
+// Tiles (r, c) and (r', c') with r + c == r' + c' share none of those, so a
+// wavefront runs each anti-diagonal of tiles in parallel. Each tile is filled
+// by the anti-diagonal kernel.
+inline long long tiledScore(std::string_view a, std::string_view b, const Scoring& sc, int tile, unsigned threads) {
+    int n = a.size(), m = b.size();
+    int tileRows = (n + tile - 1) / tile, tileCols = (m + tile - 1) / tile;
+    if (tileRows == 0 || tileCols == 0) return sc.report(sc.local() ? 0 : sc.boundary(std::max(n, m)));
+
+    std::vector<int32_t> ai(a.begin(), a.end()), rb(b.rbegin(), b.rend());
+    std::vector<int32_t> hEdge(m + 1), vEdge(n + 1);
+    for (int j = 0; j <= m; ++j) hEdge[j] = sc.boundary(j);
+    for (int i = 0; i <= n; ++i) vEdge[i] = sc.boundary(i);
+    std::vector<int32_t> corner((size_t)(tileRows + 1) * (tileCols + 1));
+    auto cornerAt = [&](int r, int c) -> int32_t& { return corner[(size_t)r * (tileCols + 1) + c]; };
+    for (int r = 0; r <= tileRows; ++r) cornerAt(r, 0) = sc.boundary(std::min(n, r * tile));
+    for (int c = 0; c <= tileCols; ++c) cornerAt(0, c) = sc.boundary(std::min(m, c * tile));
+
+    // Per-thread edge buffers for one tile.
+    struct Buffers {
+        std::vector<int32_t> top, left, bottom, right, scratch;
+        explicit Buffers(int tile) : top(tile + 1), left(tile + 1), bottom(tile + 1), right(tile + 1) {}
+    };
+    auto runTile = [&](int r, int c, Buffers& buf, int& best) {
+        int i0 = r * tile, j0 = c * tile;
+        int h = std::min(tile, n - i0), w = std::min(tile, m - j0);
+        buf.top[0] = buf.left[0] = cornerAt(r, c);
+        std::copy(&hEdge[j0 + 1], &hEdge[j0 + w + 1], &buf.top[1]);
+        std::copy(&vEdge[i0 + 1], &vEdge[i0 + h + 1], &buf.left[1]);
+        int tileBest = diagonalBlock(ai.data() + i0, h, rb.data() + (m - j0 - w), w, sc, buf.top.data(), buf.left.data(),
+                                     buf.bottom.data(), buf.right.data(), buf.scratch);
+        best = std::max(best, tileBest);
+        std::copy(&buf.bottom[1], &buf.bottom[w + 1], &hEdge[j0 + 1]);
+        std::copy(&buf.right[1], &buf.right[h + 1], &vEdge[i0 + 1]);
+        cornerAt(r + 1, c + 1) = buf.bottom[w];
+    };
+
+    threads = std::max(1u, std::min<unsigned>(threads, std::min(tileRows, tileCols)));
+    std::atomic<int> best{0};
+    if (threads == 1) {
+        Buffers buf(tile);
+        int localBest = 0;
+        for (int r = 0; r < tileRows; ++r)
+            for (int c = 0; c < tileCols; ++c) runTile(r, c, buf, localBest);
+        best = localBest;
+    } else {
+        // Wave k holds tiles (r, k - r). Workers claim tiles of the current
+        // wave from a counter; the barrier's completion step moves everyone
+        // on to the next wave once all of its tiles are done.
+        int wave = 0;
+        std::atomic<int> next{0};
+        auto waveStart = [&] { return std::max(0, wave - tileCols + 1); };
+        auto waveEnd = [&] { return std::min(wave, tileRows - 1); };
+        std::barrier sync((std::ptrdiff_t)threads, [&]() noexcept {
+            ++wave;
+            next = waveStart();
+        });
+        next = waveStart();
+        auto work = [&] {
+            Buffers buf(tile);
+            int localBest = 0;
+            while (wave < tileRows + tileCols - 1) {
+                for (int r; (r = next.fetch_add(1)) <= waveEnd();) runTile(r, wave - r, buf, localBest);
+                sync.arrive_and_wait();
+            }
+            int seen = best.load();
+            while (localBest > seen && !best.compare_exchange_weak(seen, localBest)) {}
+        };
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < threads; ++t) pool.emplace_back(work);
+        work();
+        for (auto& thread : pool) thread.join();
+    }
+    return sc.report(sc.local() ? best.load() : cornerAt(tileRows, tileCols));
+}
+
+// Picks a kernel by name, or the fastest applicable one for "auto".
+inline Result score(std::string_view a, std::string_view b, Mode mode, const std::string& kernel, unsigned threads) {
+    Scoring sc = Scoring::of(mode);
+    // Every scoring here is symmetric; keep the shorter sequence as a, the
+    // one that is split into words or tiles.
+    if (a.size() > b.size()) std::swap(a, b);
+    constexpr int kTile = 256;
+
+    // Bit-parallel needs unit costs, so it covers everything but local
+    // alignment, which gets the wavefront on large tables when there are
+    // cores to spare.
+    std::string chosen = kernel;
+    if (chosen == "auto") {
+        if (mode != Mode::Local) chosen = "bit-parallel";
+        else if (threads > 1 && (double)a.size() * b.size() >= (1 << 24)) chosen = "tiled";
+        else chosen = "diagonal";
+    }
+    if (chosen == "bit-parallel" && mode != Mode::Local) {
+        return {mode == Mode::Edit ? myersEditDistance(a, b) : bitParallelLcs(a, b), "bit-parallel"};
+    }
+    if (chosen == "tiled") return {tiledScore(a, b, sc, kTile, threads), threads > 1 ? "wavefront" : "tiled"};
+    if (chosen == "rows") {
+        NullTracer none;
+        return {rowsScore(a, b, sc, none), "rows"};
+    }
+    return {diagonalScore(a, b, sc), "diagonal"};
+}
+
+} // namespace align
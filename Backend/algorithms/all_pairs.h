@@ -0,0 +1,281 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "shortest_path.h"
+
+// Multi-source and all-pairs shortest distances over a CsrGraph, on every
+// core. Two kernels:
+//
+//   dijkstra        one search per source. Threads claim blocks of kTile
+//                   sources from a counter; each keeps one heap and kTile
+//                   distance rows for its whole life, so nothing is
+//                   allocated per source, and all of them share the graph
+//                   read-only.
+//   floyd-warshall  blocked Floyd-Warshall over the n x n matrix in kTile x
+//                   kTile blocks. For each pivot block: the block itself,
+//                   then the blocks in its row and column, then all the
+//                   rest, each phase spread over the threads, with the inner
+//                   loop eight columns at a time in vector instructions. It
+//                   does n^3 work whatever the edges, but without a heap or
+//                   scattered reads, which wins on small dense graphs.
+//
+// Results come out as tiles of up to kTile x kTile distances, a block of
+// sources by a block of nodes, instead of per-step trace lines; see
+// encodeTile for the wire format. Unreachable nodes are at kInf. Every
+// distance must be below kFar; checkDistanceRange refuses graphs where one
+// might not be.
+namespace apsp {
+
+constexpr int kTile = 64;
+
+// "No path yet" inside Floyd-Warshall: the sum of two of them still fits in
+// an int, so the inner loop needs no overflow checks.
+constexpr int kFar = sp::kInf / 2;
+
+// Throws invalid_argument unless every shortest distance in g is sure to be
+// below kFar. Below it both kernels give the same answers and Dijkstra's sums
+// fit in an int. A shortest path is simple, so it is no longer than n - 1 of
+// the heaviest edge, nor than all the edges put together.
+inline void checkDistanceRange(const sp::CsrGraph& g) {
+    int64_t heaviest = 0, total = 0;
+    for (int w : g.weights) {
+        heaviest = std::max<int64_t>(heaviest, w);
+        total += w;
+    }
+    int64_t longest = std::min((int64_t)std::max(g.size() - 1, 0) * heaviest, total);
+    if (longest >= kFar) {
+        throw std::invalid_argument("Distances could reach " + std::to_string(kFar) + "; all-pairs needs smaller weights");
+    }
+}
+
+// Receives rows [row, row + rows) of the result (indices into the source
+// list) restricted to nodes [col, col + cols); row r of the tile starts at
+// data + r * stride. Called from several threads at once.
+using TileSink = std::function<void(int row, int col, int rows, int cols, const int* data, size_t stride)>;
+
+// Auto picks Floyd-Warshall when every node is a source, there are at most
+// kFloydMaxNodes of them, and each lists at least n / kFloydDensity edges;
+// around that density the two kernels break even (bench/all_pairs_bench.cpp).
+constexpr int kFloydMaxNodes = 2048;
+constexpr int kFloydDensity = 128;
+
+inline const char* chooseKernel(const sp::CsrGraph& g, size_t sources, const std::string& kernel) {
+    if (kernel == "dijkstra" || kernel == "floyd-warshall") return kernel == "dijkstra" ? "dijkstra" : "floyd-warshall";
+    size_t n = g.size();
+    bool dense = g.targets.size() * kFloydDensity >= n * n;
+    return n > 0 && sources == n && n <= kFloydMaxNodes && dense ? "floyd-warshall" : "dijkstra";
+}
+
+// Hands rows [row, row + rows) to the sink one column tile at a time.
+inline void emitRows(int row, int rows, const int* data, size_t stride, int n, const TileSink& sink) {
+    for (int col = 0; col < n; col += kTile) sink(row, col, rows, std::min(kTile, n - col), data + col, stride);
+}
+
+// Distances from s to every node into dist[0..n). `heap` is scratch space
+// reused between calls.
+inline void distancesFrom(const sp::CsrGraph& g, int s, int* dist, std::vector<std::pair<int, int>>& heap) {
+    std::fill(dist, dist + g.size(), sp::kInf);
+    dist[s] = 0;
+    heap.assign(1, {0, s});
+    auto later = std::greater<>();
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        auto [d, u] = heap.back();
+        heap.pop_back();
+        if (d > dist[u]) continue;
+        for (uint32_t e = g.offsets[u]; e < g.offsets[u + 1]; ++e) {
+            int v = g.targets[e], nd = d + g.weights[e];
+            if (nd >= dist[v]) continue;
+            dist[v] = nd;
+            heap.push_back({nd, v});
+            std::push_heap(heap.begin(), heap.end(), later);
+        }
+    }
+}
+
+// One Dijkstra per source (dense indices), `threads` at a time.
+inline void dijkstraTiles(const sp::CsrGraph& g, const std::vector<int>& sources, unsigned threads, const TileSink& sink) {
+    int n = g.size(), count = sources.size();
+    int blocks = (count + kTile - 1) / kTile;
+    std::atomic<int> next{0};
+    auto work = [&] {
+        std::vector<int> rows((size_t)kTile * n);
+        std::vector<std::pair<int, int>> heap;
+        for (int b; (b = next.fetch_add(1, std::memory_order_relaxed)) < blocks;) {
+            int first = b * kTile, h = std::min(kTile, count - first);
+            for (int r = 0; r < h; ++r) distancesFrom(g, sources[first + r], &rows[(size_t)r * n], heap);
+            emitRows(first, h, rows.data(), n, n, sink);
+        }
+    };
+    threads = std::max(1u, std::min<unsigned>(threads, blocks));
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(work);
+    work();
+    for (auto& thread : pool) thread.join();
+}
+
+#if defined(__GNUC__)
+// Eight int32 lanes; UnalignedLanes reads and writes them at any int32
+// address.
+using Lanes = int32_t __attribute__((vector_size(32)));
+using UnalignedLanes = int32_t __attribute__((vector_size(32), aligned(4)));
+constexpr int kLanes = 8;
+#endif
+
+// c[i][j] = min(c[i][j], a[i][k] + b[k][j]) for the kTile pivots k of one
+// block, in pivot order, so c may be a or b (the phases that touch the pivot
+// block's own row or column). Baseline x86-64 has no vector min, so an AVX2
+// clone is also compiled and picked at load time.
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(__clang__)
+__attribute__((target_clones("avx2", "default")))
+#endif
+inline void relaxBlock(int* c, const int* a, const int* b, size_t stride) {
+    for (int k = 0; k < kTile; ++k) {
+        const int* bk = b + k * stride;
+        for (int i = 0; i < kTile; ++i) {
+            int aik = a[i * stride + k];
+            int* ci = c + i * stride;
+#if defined(__GNUC__)
+            auto at = [](const int* p) -> const UnalignedLanes& { return *reinterpret_cast<const UnalignedLanes*>(p); };
+            for (int j = 0; j < kTile; j += kLanes) {
+                Lanes through = at(bk + j) + aik, current = at(ci + j);
+                *reinterpret_cast<UnalignedLanes*>(ci + j) = through < current ? through : current;
+            }
+#else
+            for (int j = 0; j < kTile; ++j) ci[j] = std::min(ci[j], aik + bk[j]);
+#endif
+        }
+    }
+}
+
+// The full distance matrix, n rounded up to whole blocks on both sides;
+// entries are kFar where there is no path.
+inline std::vector<int> floydWarshall(const sp::CsrGraph& g, unsigned threads, size_t& stride) {
+    int n = g.size(), blocks = (n + kTile - 1) / kTile;
+    stride = (size_t)blocks * kTile;
+    std::vector<int> d(stride * stride, kFar);
+    for (size_t i = 0; i < stride; ++i) d[i * stride + i] = 0;
+    for (int u = 0; u < n; ++u)
+        for (uint32_t e = g.offsets[u]; e < g.offsets[u + 1]; ++e) {
+            int& cell = d[u * stride + g.targets[e]];
+            cell = std::min(cell, g.weights[e]);
+        }
+    if (blocks == 0) return d;
+    auto block = [&](int r, int c) { return d.data() + (size_t)r * kTile * stride + (size_t)c * kTile; };
+
+    // Step 3p + q is phase q of pivot block p. Tasks of a phase are claimed
+    // from a counter; the barrier's completion step starts the next phase
+    // once all of them are done. Phase 1 task t < others is block (p, x),
+    // otherwise (x, p); phase 2 task t is block (t / others, t % others);
+    // x skips over p.
+    int others = blocks - 1;
+    auto taskCount = [&](int phase) { return phase == 0 ? 1 : phase == 1 ? 2 * others : others * others; };
+    auto skip = [](int x, int p) { return x + (x >= p); };
+    int step = 0;
+    std::atomic<int> next{0};
+    threads = std::max(1u, std::min<unsigned>(threads, std::max(1, others * others)));
+    std::barrier sync((std::ptrdiff_t)threads, [&]() noexcept {
+        ++step;
+        next = 0;
+    });
+    auto work = [&] {
+        while (step < 3 * blocks) {
+            int p = step / 3, phase = step % 3, tasks = taskCount(phase);
+            for (int t; (t = next.fetch_add(1)) < tasks;) {
+                if (phase == 0) {
+                    relaxBlock(block(p, p), block(p, p), block(p, p), stride);
+                } else if (phase == 1) {
+                    int x = skip(t % others, p);
+                    if (t < others) relaxBlock(block(p, x), block(p, p), block(p, x), stride);
+                    else relaxBlock(block(x, p), block(x, p), block(p, p), stride);
+                } else {
+                    int i = skip(t / others, p), j = skip(t % others, p);
+                    relaxBlock(block(i, j), block(i, p), block(p, j), stride);
+                }
+            }
+            sync.arrive_and_wait();
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(work);
+    work();
+    for (auto& thread : pool) thread.join();
+    return d;
+}
+
+// Floyd-Warshall, then the rows of `sources` in tiles.
+inline void floydWarshallTiles(const sp::CsrGraph& g, const std::vector<int>& sources, unsigned threads,
+                               const TileSink& sink) {
+    size_t stride;
+    std::vector<int> d = floydWarshall(g, threads, stride);
+    int n = g.size(), count = sources.size();
+    std::vector<int> rows((size_t)kTile * n);
+    for (int first = 0; first < count; first += kTile) {
+        int h = std::min(kTile, count - first);
+        for (int r = 0; r < h; ++r) {
+            const int* from = &d[(size_t)sources[first + r] * stride];
+            std::transform(from, from + n, &rows[(size_t)r * n], [](int v) { return v >= kFar ? sp::kInf : v; });
+        }
+        emitRows(first, h, rows.data(), n, n, sink);
+    }
+}
+
+// Runs the kernel named by chooseKernel and returns its name. g must pass
+// checkDistanceRange.
+inline const char* distances(const sp::CsrGraph& g, const std::vector<int>& sources, const std::string& kernel,
+                             unsigned threads, const TileSink& sink) {
+    const char* chosen = chooseKernel(g, sources.size(), kernel);
+    if (std::string(chosen) == "floyd-warshall") floydWarshallTiles(g, sources, threads, sink);
+    else dijkstraTiles(g, sources, threads, sink);
+    return chosen;
+}
+
+// Tile wire format. Each distance becomes u = distance + 1, or 0 if
+// unreachable; the tile is written row by row as the difference between u
+// and the u above it (to its left in the first row), zigzag-encoded as an
+// unsigned LEB128 varint; the bytes are then base64-encoded. Sources in one
+// tile are usually near each other, so most differences fit in one byte.
+inline std::string base64(const std::string& bytes) {
+    static constexpr char kDigits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((bytes.size() + 2) / 3 * 4);
+    for (size_t i = 0; i < bytes.size(); i += 3) {
+        uint32_t chunk = (uint8_t)bytes[i] << 16;
+        if (i + 1 < bytes.size()) chunk |= (uint8_t)bytes[i + 1] << 8;
+        if (i + 2 < bytes.size()) chunk |= (uint8_t)bytes[i + 2];
+        out += kDigits[chunk >> 18];
+        out += kDigits[(chunk >> 12) & 63];
+        out += i + 1 < bytes.size() ? kDigits[(chunk >> 6) & 63] : '=';
+        out += i + 2 < bytes.size() ? kDigits[chunk & 63] : '=';
+    }
+    return out;
+}
+
+inline std::string encodeTile(const int* data, size_t stride, int rows, int cols) {
+    auto code = [](int d) -> int64_t { return d == sp::kInf ? 0 : (int64_t)d + 1; };
+    std::string bytes;
+    bytes.reserve((size_t)rows * cols);
+    for (int r = 0; r < rows; ++r) {
+        const int* row = data + r * stride;
+        for (int c = 0; c < cols; ++c) {
+            int64_t base = r > 0 ? code(row[c - (int64_t)stride]) : c > 0 ? code(row[c - 1]) : 0;
+            int64_t delta = code(row[c]) - base;
+            uint64_t zigzag = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+            do {
+                bytes += (char)((zigzag & 127) | (zigzag > 127 ? 128 : 0));
+                zigzag >>= 7;
+            } while (zigzag);
+        }
+    }
+    return base64(bytes);
+}
+
+} // namespace apsp
@@ -0,0 +1,144 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "trace_writer.h"
+
+// Batch mode for binaries started with --batch.
+//
+// Instead of one input on the command line, the binary reads one input per
+// line from stdin, with the fields a normal run takes as arguments separated
+// by tabs, and runs them all across a pool of worker threads. Each input
+// produces one frame on stdout, in input order:
+//
+//   {"batch": 0, "result": <json>}
+//   {"batch": 1, "result": <json>, "steps": [<step>, <step>, ...]}   (--batch-traces)
+//   {"batch": 2, "error": "<what went wrong>"}
+//
+// followed by a summary frame {"batch": "end", "count": <n>, "errors": <n>, "ms": <wall time>}.
+// Steps are the objects a normal run would stream, collected per input.
+//
+// Options:
+//   --batch            enable batch mode
+//   --batch-traces     include each input's steps in its frame
+//   --threads=<n>      worker threads (default and maximum: one per core)
+
+struct BatchOptions {
+    bool enabled = false;
+    bool traces = false;
+    unsigned threads = 0;
+};
+
+inline unsigned maxThreads() { return std::max(1u, std::thread::hardware_concurrency()); }
+
+// The n of --threads=<n>, capped at maxThreads(); 0 means the default.
+// Throws invalid_argument unless `text` is a decimal number.
+inline unsigned parseThreadCount(const std::string& text) {
+    if (text.empty() || !std::all_of(text.begin(), text.end(), [](unsigned char c) { return std::isdigit(c); })) {
+        throw std::invalid_argument("--threads needs a whole number, not " + text);
+    }
+    size_t digits = text.size() - std::min(text.find_first_not_of('0'), text.size());
+    if (digits > 9) return maxThreads();  // would not fit in an unsigned
+    return std::min((unsigned)std::stoul(text), maxThreads());
+}
+
+// Consumes one batch option; returns false if `option` is not one. Throws
+// invalid_argument for a malformed value.
+inline bool parseBatchOption(const std::string& option, BatchOptions& batch) {
+    if (option == "--batch") batch.enabled = true;
+    else if (option == "--batch-traces") batch.enabled = batch.traces = true;
+    else if (option.rfind("--threads=", 0) == 0) batch.threads = parseThreadCount(option.substr(10));
+    else return false;
+    return true;
+}
+
+// The steps of one input, as comma-separated JSON objects.
+struct StepBuffer {
+    std::string json;
+
+    void add(std::string_view step) {
+        if (!json.empty()) json += ", ";
+        json += step;
+    }
+};
+
+inline std::vector<std::string> splitFields(const std::string& line) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    for (;;) {
+        size_t tab = line.find('\t', start);
+        fields.push_back(line.substr(start, tab - start));
+        if (tab == std::string::npos) break;
+        start = tab + 1;
+    }
+    if (fields.size() == 1 && fields[0].empty()) fields.clear();
+    return fields;
+}
+
+// Runs job(fields, steps) for every input on stdin and streams the frames.
+// `job` returns the input's result as JSON text and may throw to report a bad
+// input; `steps` is null unless --batch-traces was given.
+template <class Job>
+int runBatch(const BatchOptions& batch, Job job) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::vector<std::string>> inputs;
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        inputs.push_back(splitFields(line));
+    }
+
+    // Frames finish out of order; each finished frame waits in `frames` until
+    // every earlier one has been written, so the output stays in input order
+    // while only one thread at a time feeds the trace writer.
+    std::vector<std::optional<std::string>> frames(inputs.size());
+    std::mutex frameLock;
+    size_t nextToWrite = 0;
+    std::atomic<size_t> nextInput{0};
+    std::atomic<size_t> errors{0};
+
+    auto work = [&] {
+        for (size_t i; (i = nextInput.fetch_add(1, std::memory_order_relaxed)) < inputs.size();) {
+            std::string frame = "{\"batch\": " + std::to_string(i) + ", ";
+            try {
+                StepBuffer steps;
+                std::string result = job(inputs[i], batch.traces ? &steps : nullptr);
+                frame += "\"result\": " + result;
+                if (batch.traces) frame += ", \"steps\": [" + steps.json + "]";
+            } catch (const std::exception& e) {
+                frame += "\"error\": " + jsonString(e.what());
+                errors.fetch_add(1, std::memory_order_relaxed);
+            }
+            frame += "}";
+
+            std::lock_guard<std::mutex> guard(frameLock);
+            frames[i] = std::move(frame);
+            while (nextToWrite < frames.size() && frames[nextToWrite]) {
+                trace::emit(*frames[nextToWrite]);
+                frames[nextToWrite++].reset();
+            }
+        }
+    };
+
+    unsigned threads = batch.threads ? std::min(batch.threads, maxThreads()) : maxThreads();
+    threads = (unsigned)std::min<size_t>(threads, std::max<size_t>(inputs.size(), 1));
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(work);
+    work();
+    for (auto& thread : pool) thread.join();
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    trace::emit("{\"batch\": \"end\", \"count\": " + std::to_string(inputs.size()) +
+                ", \"errors\": " + std::to_string(errors.load()) + ", \"ms\": " + std::to_string(ms) + "}");
+    return 0;
+}
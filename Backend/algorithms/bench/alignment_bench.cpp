@@ -0,0 +1,70 @@
+// Alignment kernels: every kernel is first checked against the row-by-row
+// reference on random inputs of assorted lengths and alphabets, then timed
+// on one pair of long sequences. Bit-parallel does not apply to local
+// alignment and falls back to the diagonal kernel there.
+//
+//   g++ -std=c++20 -O2 -pthread bench/alignment_bench.cpp -o alignment_bench && ./alignment_bench [length] [threads]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include "../alignment.h"
+
+using namespace std;
+
+string randomText(mt19937& rng, int length, int alphabet) {
+    uniform_int_distribution<int> letter(0, alphabet - 1);
+    string s(length, 'a');
+    for (char& c : s) c = 'a' + letter(rng);
+    return s;
+}
+
+int fail(const char* kernel, long long got, long long expected, const string& a, const string& b) {
+    fprintf(stderr, "%s gives %lld, rows gives %lld for \"%s\" / \"%s\"\n", kernel, got, expected, a.c_str(), b.c_str());
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    int length = argc > 1 ? atoi(argv[1]) : 20000;
+    unsigned threads = argc > 2 ? atoi(argv[2]) : 4;
+    mt19937 rng(11);
+    NullTracer none;
+    const align::Mode modes[] = {align::Mode::Edit, align::Mode::Lcs, align::Mode::Local};
+    const char* kernels[] = {"diagonal", "bit-parallel", "tiled"};
+
+    uniform_int_distribution<int> size(0, 300);
+    for (int round = 0; round < 2000; ++round) {
+        int alphabet = round % 3 == 0 ? 2 : round % 3 == 1 ? 4 : 26;
+        string a = randomText(rng, size(rng), alphabet);
+        string b = randomText(rng, size(rng), alphabet);
+        for (align::Mode mode : modes) {
+            long long expected = align::rowsScore(a, b, align::Scoring::of(mode), none);
+            for (const char* kernel : kernels) {
+                align::Result r = align::score(a, b, mode, kernel, 1);
+                if (r.score != expected) return fail(r.kernel, r.score, expected, a, b);
+            }
+            // Small tiles, so that edges and corners carry between many of them.
+            for (unsigned t : {1u, 3u}) {
+                long long got = align::tiledScore(a, b, align::Scoring::of(mode), 16, t);
+                if (got != expected) return fail(t > 1 ? "wavefront" : "tiled", got, expected, a, b);
+            }
+        }
+    }
+
+    string a = randomText(rng, length, 4), b = randomText(rng, length, 4);
+    double cells = (double)(length + 1) * (length + 1);
+    printf("%d x %d, alphabet 4, %u threads for the wavefront\n", length, length, threads);
+    printf("%-6s %-14s %10s %12s %10s\n", "mode", "kernel", "ms", "Mcells/s", "score");
+    const char* names[] = {"edit", "lcs", "local"};
+    for (align::Mode mode : modes) {
+        for (const char* kernel : {"rows", "diagonal", "bit-parallel", "tiled", "tiled*"}) {
+            bool wave = string(kernel) == "tiled*";
+            auto start = chrono::steady_clock::now();
+            align::Result r = align::score(a, b, mode, wave ? "tiled" : kernel, wave ? threads : 1);
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            printf("%-6s %-14s %10.1f %12.0f %10lld\n", names[(int)mode], r.kernel, ms, cells / ms / 1000, r.score);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,83 @@
+// All-pairs distances on random graphs of several sizes and densities: one
+// Dijkstra per source against blocked Floyd-Warshall, both on every core, and
+// Dijkstra on one thread for the speedup. The two kernels must agree on every
+// distance. Also reports the encoded tile size against 4 bytes a distance.
+//
+//   g++ -std=c++20 -O2 -pthread bench/all_pairs_bench.cpp -o all_pairs_bench && ./all_pairs_bench [threads]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "../all_pairs.h"
+
+using namespace std;
+
+struct Edge {
+    int to;
+    int weight;
+};
+
+static sp::CsrGraph randomGraph(int n, int degree, mt19937& rng) {
+    uniform_int_distribution<int> node(0, n - 1), weight(1, 100);
+    map<int, vector<Edge>> adjacency;
+    // A ring keeps it connected; the rest are random chords.
+    for (int u = 0; u < n; ++u) {
+        int v = (u + 1) % n, w = weight(rng);
+        adjacency[u].push_back({v, w});
+        adjacency[v].push_back({u, w});
+    }
+    for (long long e = 0; e < (long long)n * (degree - 2) / 2; ++e) {
+        int u = node(rng), v = node(rng), w = weight(rng);
+        adjacency[u].push_back({v, w});
+        adjacency[v].push_back({u, w});
+    }
+    return sp::CsrGraph::from(adjacency);
+}
+
+int main(int argc, char* argv[]) {
+    unsigned threads = argc > 1 ? atoi(argv[1]) : max(1u, thread::hardware_concurrency());
+    mt19937 rng(11);
+    printf("%6s %6s %12s %12s %12s %8s %8s\n", "nodes", "degree", "dijkstra/1", "dijkstra", "floyd", "auto", "bytes/d");
+
+    for (int n : {256, 1024, 2048}) {
+        for (int degree : {4, 16, 64}) {
+            sp::CsrGraph g = randomGraph(n, degree, rng);
+            vector<int> sources(n);
+            for (int i = 0; i < n; ++i) sources[i] = i;
+
+            vector<int> byDijkstra((size_t)n * n), byFloyd((size_t)n * n);
+            size_t encoded = 0;
+            mutex lock;
+            auto into = [&](vector<int>& out, bool measure) -> apsp::TileSink {
+                return [&out, &encoded, &lock, n, measure](int row, int col, int rows, int cols, const int* data, size_t stride) {
+                    for (int r = 0; r < rows; ++r)
+                        copy(data + r * stride, data + r * stride + cols, &out[(size_t)(row + r) * n + col]);
+                    if (!measure) return;
+                    size_t bytes = apsp::encodeTile(data, stride, rows, cols).size();
+                    lock_guard<mutex> guard(lock);
+                    encoded += bytes;
+                };
+            };
+            auto time = [](auto run) {
+                auto start = chrono::steady_clock::now();
+                run();
+                return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            };
+
+            double single = time([&] { apsp::dijkstraTiles(g, sources, 1, into(byDijkstra, false)); });
+            double parallel = time([&] { apsp::dijkstraTiles(g, sources, threads, into(byDijkstra, true)); });
+            double floyd = time([&] { apsp::floydWarshallTiles(g, sources, threads, into(byFloyd, false)); });
+            if (byDijkstra != byFloyd) {
+                printf("MISMATCH at n=%d degree=%d\n", n, degree);
+                return 1;
+            }
+            printf("%6d %6d %10.1fms %10.1fms %10.1fms %8s %8.2f\n", n, degree, single, parallel, floyd,
+                   apsp::chooseKernel(g, n, "auto")[0] == 'f' ? "floyd" : "dijkstra", (double)encoded / n / n);
+        }
+    }
+    return 0;
+}
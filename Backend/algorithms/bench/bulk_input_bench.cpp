@@ -0,0 +1,87 @@
+// Cost of getting N integers into a binary: one argv string per value parsed
+// with stoi (how SortingAlgorithm used to take its input), text parsed with
+// from_chars, and the i32 binary format copied out of the input. The binary
+// format is also read back through a file mapped as stdin would be. Every
+// method must produce the same values.
+//
+//   g++ -std=c++20 -O2 bench/bulk_input_bench.cpp -o bulk_input_bench && ./bulk_input_bench [count]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include "../bulk_input.h"
+
+using namespace std;
+
+template <class F>
+double timeMs(F&& f) {
+    auto start = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 10'000'000;
+    mt19937 rng(11);
+    uniform_int_distribution<int32_t> value(-1'000'000'000, 1'000'000'000);
+    vector<int32_t> values(count);
+    for (auto& v : values) v = value(rng);
+
+    vector<string> args;
+    string text;
+    for (int32_t v : values) {
+        args.push_back(to_string(v));
+        text += args.back();
+        text += '\n';
+    }
+    string binary(reinterpret_cast<const char*>(values.data()), count * sizeof(int32_t));
+
+    // Map the binary input the way Input::readStdin does for a redirected file.
+    char path[] = "/tmp/bulk_input_benchXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0 || write(fd, binary.data(), binary.size()) != (ssize_t)binary.size()) {
+        perror("temp file");
+        return 1;
+    }
+    unlink(path);
+
+    vector<int32_t> out;
+    struct Row {
+        const char* name;
+        double ms;
+        bool same;
+    };
+    vector<Row> rows;
+    auto run = [&](const char* name, auto&& parse) {
+        out.clear();
+        double ms = timeMs(parse);
+        rows.push_back({name, ms, out == values});
+    };
+
+    run("argv + stoi", [&] {
+        out.reserve(count);
+        for (const string& a : args) out.push_back(stoi(a));
+    });
+    run("text from_chars", [&] { out = bulk::parseNumbers<int32_t>(text); });
+    run("i32 memcpy", [&] { out = bulk::decodeIntegers<int32_t>(binary); });
+    run("i32 mmap", [&] {
+        void* p = mmap(nullptr, binary.size(), PROT_READ, MAP_PRIVATE, fd, 0);
+        out = bulk::decodeIntegers<int32_t>(string_view(static_cast<const char*>(p), binary.size()));
+        munmap(p, binary.size());
+    });
+    close(fd);
+
+    printf("%zu integers (%zu bytes as text, %zu as i32)\n", count, text.size(), binary.size());
+    printf("%-16s %10s %12s\n", "method", "ms", "ns/value");
+    for (const Row& r : rows) {
+        if (!r.same) {
+            fprintf(stderr, "%s produced different values\n", r.name);
+            return 1;
+        }
+        printf("%-16s %10.1f %12.2f\n", r.name, r.ms, r.ms * 1e6 / count);
+    }
+    return 0;
+}
@@ -0,0 +1,88 @@
+// Point-to-point query cost on a road-like grid graph: full Dijkstra (the old
+// behaviour, run until the queue empties), Dijkstra with early exit,
+// bidirectional Dijkstra, and A* over a landmark index. All four must agree
+// on every path cost.
+//
+//   g++ -std=c++20 -O2 bench/shortest_path_bench.cpp -o shortest_path_bench && ./shortest_path_bench [side] [queries]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <random>
+#include <vector>
+#include "../shortest_path.h"
+
+using namespace std;
+
+struct Edge {
+    int to;
+    int weight;
+};
+
+int main(int argc, char* argv[]) {
+    int side = argc > 1 ? atoi(argv[1]) : 300;
+    int queryCount = argc > 2 ? atoi(argv[2]) : 200;
+    mt19937 rng(7);
+    uniform_int_distribution<int> weight(1, 100);
+
+    map<int, vector<Edge>> adjacency;
+    auto link = [&](int u, int v) {
+        int w = weight(rng);
+        adjacency[u].push_back({v, w});
+        adjacency[v].push_back({u, w});
+    };
+    for (int r = 0; r < side; ++r)
+        for (int c = 0; c < side; ++c) {
+            if (c + 1 < side) link(r * side + c, r * side + c + 1);
+            if (r + 1 < side) link(r * side + c, (r + 1) * side + c);
+        }
+    sp::CsrGraph g = sp::CsrGraph::from(adjacency);
+
+    uniform_int_distribution<int> node(0, g.size() - 1);
+    vector<pair<int, int>> queries(queryCount);
+    for (auto& q : queries) q = {node(rng), node(rng)};
+
+    auto start = chrono::steady_clock::now();
+    sp::AltIndex alt = sp::AltIndex::build(g, 8);
+    double buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    NullTracer none;
+    sp::Labels a, b;
+    struct Method {
+        const char* name;
+        function<sp::PathResult(int, int)> run;
+        vector<int> costs = {};
+        double micros = 0;
+        size_t settled = 0;
+    };
+    Method methods[] = {
+        {"full dijkstra", [&](int s, int) { return sp::dijkstra(g, s, -1, a, none); }},
+        {"early exit", [&](int s, int t) { return sp::dijkstra(g, s, t, a, none); }},
+        {"bidirectional", [&](int s, int t) { return sp::bidirectionalDijkstra(g, s, t, a, b, none); }},
+        {"alt", [&](int s, int t) { return alt.query(s, t, a, none); }},
+    };
+
+    for (Method& m : methods) {
+        for (auto [s, t] : queries) {
+            auto begin = chrono::steady_clock::now();
+            sp::PathResult r = m.run(s, t);
+            m.micros += chrono::duration<double, micro>(chrono::steady_clock::now() - begin).count();
+            m.settled += r.settled;
+            // A full run leaves every distance in the labels.
+            m.costs.push_back(r.cost == sp::kInf ? a.distance(t) : r.cost);
+        }
+        if (m.costs != methods[0].costs) {
+            fprintf(stderr, "%s disagrees with full dijkstra\n", m.name);
+            return 1;
+        }
+    }
+
+    printf("%d nodes, %zu edges, %d queries; landmark index built in %.1f ms\n",
+           g.size(), g.targets.size() / 2, queryCount, buildMs);
+    printf("%-14s %14s %16s\n", "method", "us/query", "settled/query");
+    for (const Method& m : methods) {
+        printf("%-14s %14.1f %16.0f\n", m.name, m.micros / queryCount, (double)m.settled / queryCount);
+    }
+    return 0;
+}
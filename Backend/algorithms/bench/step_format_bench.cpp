@@ -0,0 +1,102 @@
+// Cost of formatting one traced step: building the message text and the JSON
+// line with strings and streams (how every binary used to do it) against a
+// message ID with integer arguments written through trace::Line. Counts heap
+// allocations per step by replacing operator new. Lines are formatted but
+// not emitted, so only the formatting is measured.
+//
+//   g++ -std=c++20 -O2 -pthread bench/step_format_bench.cpp -o step_format_bench && ./step_format_bench [elements]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../sorting.h"
+#include "../trace_line.h"
+
+using namespace std;
+
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+    ++allocations;
+    if (void* p = malloc(size)) return p;
+    throw bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// Message text the way the steps used to build it.
+string messageText(const msg::Message& m, const vector<int>& arr) {
+    switch (m.id) {
+        case msg::Compare: return "Comparing " + to_string(arr[m.args[0]]) + " and " + to_string(arr[m.args[1]]);
+        case msg::Swap: return "Swapping " + to_string(arr[m.args[0]]) + " and " + to_string(arr[m.args[1]]);
+        default: return "No swap needed";
+    }
+}
+
+struct StringTracer {
+    static constexpr bool enabled = true;
+    size_t bytes = 0;
+
+    void step(const vector<int>& arr, const msg::Message& message, int depth, int position, const char* action,
+              int pivotIndex = -1, int swapA = -1, int swapB = -1) {
+        string text = messageText(message, arr);
+        ostringstream out;
+        out << "{\"array\": [";
+        for (size_t i = 0; i < arr.size(); ++i) {
+            out << arr[i];
+            if (i + 1 < arr.size()) out << ", ";
+        }
+        out << "], \"message\": \"" << text << "\", \"depth\": " << depth << ", \"position\": " << position
+            << ", \"action\": \"" << action << "\", \"pivotIndex\": " << pivotIndex << ", \"swap\": [" << swapA << ", " << swapB << "]}";
+        bytes += out.str().size();
+    }
+};
+
+struct LineTracer {
+    static constexpr bool enabled = true;
+    size_t bytes = 0;
+    trace::Line line;
+
+    void step(const vector<int>& arr, const msg::Message& message, int depth, int position, const char* action,
+              int pivotIndex = -1, int swapA = -1, int swapB = -1) {
+        line.raw("{\"array\": ").array(arr).raw(", ");
+        line.message(message).raw(", ");
+        line.raw("\"depth\": ").number(depth).raw(", \"position\": ").number(position);
+        line.raw(", \"action\": \"").raw(action).raw("\", \"pivotIndex\": ").number(pivotIndex);
+        line.raw(", \"swap\": [").number(swapA).raw(", ").number(swapB).raw("]}");
+        bytes += line.view().size();
+        line.clear();
+    }
+};
+
+template <class Tracer>
+void run(const char* name, const vector<int>& input) {
+    Tracer tracer;
+    vector<int> arr = input;
+    // One warm-up step so the line buffer has its final size.
+    tracer.step(arr, msg::Message(msg::Swap, 0, 1), 1, 0, "swap", -1, 0, 1);
+
+    size_t steps = (size_t)arr.size() * (arr.size() - 1) / 2 * 2;
+    size_t before = allocations;
+    auto start = chrono::steady_clock::now();
+    bubbleSort(arr, tracer);
+    double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    printf("%-8s %12.0f %14.2f %12.0f\n", name, ns / steps, (double)(allocations - before) / steps, (double)tracer.bytes / steps);
+}
+
+int main(int argc, char* argv[]) {
+    int n = argc > 1 ? atoi(argv[1]) : 300;
+    mt19937 rng(3);
+    vector<int> input(n);
+    for (int& v : input) v = rng() % 100000;
+
+    printf("bubble sort of %d ints, two steps per comparison\n", n);
+    printf("%-8s %12s %14s %12s\n", "format", "ns/step", "allocs/step", "bytes/step");
+    run<StringTracer>("strings", input);
+    run<LineTracer>("line", input);
+    return 0;
+}
@@ -0,0 +1,121 @@
+// Compares the string sorts in string_sort.h with std::sort on a few string
+// shapes, and sortRecords() with std::sort on records carrying a payload.
+//
+//   g++ -std=c++20 -O2 bench/string_sort_bench.cpp -o string_sort_bench && ./string_sort_bench [n]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include "../sorting.h"
+
+using namespace std;
+
+vector<string> randomWords(size_t n, mt19937& rng) {
+    uniform_int_distribution<int> len(4, 24), ch('a', 'z');
+    vector<string> out(n);
+    for (auto& s : out) {
+        s.resize(len(rng));
+        for (char& c : s) c = (char)ch(rng);
+    }
+    return out;
+}
+
+// Log lines share long prefixes: the date, most of the time, a level and a
+// handful of component names.
+vector<string> logLines(size_t n, mt19937& rng) {
+    const char* levels[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+    const char* components[] = {"server", "server.http", "server.http.router", "db.pool", "scheduler"};
+    uniform_int_distribution<int> minute(0, 59), second(0, 59), milli(0, 999), level(0, 3), comp(0, 4), id(0, 999999);
+    vector<string> out(n);
+    char buf[160];
+    for (auto& s : out) {
+        snprintf(buf, sizeof buf, "2025-05-07T11:%02d:%02d.%03dZ %s %s: handled request id=%06d status=200",
+                 minute(rng), second(rng), milli(rng), levels[level(rng)], components[comp(rng)], id(rng));
+        s = buf;
+    }
+    return out;
+}
+
+vector<string> urls(size_t n, mt19937& rng) {
+    const char* paths[] = {"/api/v1/users/", "/api/v1/users/profile/", "/api/v1/orders/", "/static/assets/img/"};
+    uniform_int_distribution<int> path(0, 3), id(0, 9999999);
+    vector<string> out(n);
+    for (auto& s : out) s = "https://tutor.example.com" + string(paths[path(rng)]) + to_string(id(rng));
+    return out;
+}
+
+double bestOf(int reps, const vector<string>& input, const vector<string>& expected,
+              const function<void(vector<string>&)>& sort) {
+    double best = 1e300;
+    for (int r = 0; r < reps; ++r) {
+        vector<string> data = input;
+        auto start = chrono::steady_clock::now();
+        sort(data);
+        best = min(best, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+        if (data != expected) {
+            fprintf(stderr, "sort produced wrong order\n");
+            exit(1);
+        }
+    }
+    return best;
+}
+
+struct LogRecord {
+    string line;
+    char payload[200];
+};
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+    mt19937 rng(2025);
+    NullTracer none;
+
+    struct Dataset {
+        const char* name;
+        vector<string> data;
+    };
+    Dataset datasets[] = {
+        {"random words", randomWords(n, rng)},
+        {"log lines", logLines(n, rng)},
+        {"urls", urls(n, rng)},
+    };
+
+    printf("%-14s %10s %12s %12s %12s %12s\n", "dataset", "n", "std::sort", "msd-radix", "multikey-qs", "lcp-merge");
+    for (const Dataset& d : datasets) {
+        vector<string> expected = d.data;
+        sort(expected.begin(), expected.end());
+        double stdMs = bestOf(3, d.data, expected, [](vector<string>& a) { sort(a.begin(), a.end()); });
+        double msdMs = bestOf(3, d.data, expected, [&](vector<string>& a) { strsort::msdRadixSort(a, none); });
+        double mkqMs = bestOf(3, d.data, expected, [&](vector<string>& a) { strsort::multikeyQuicksort(a, none); });
+        double lcpMs = bestOf(3, d.data, expected, [&](vector<string>& a) { strsort::lcpMergeSort(a, none); });
+        printf("%-14s %10zu %12.1f %12.1f %12.1f %12.1f\n", d.name, d.data.size(), stdMs, msdMs, mkqMs, lcpMs);
+    }
+
+    // Key plus payload: records are large, so the record sort should only
+    // move each one once.
+    vector<LogRecord> records(n / 4);
+    for (size_t i = 0; i < records.size(); ++i) records[i].line = datasets[1].data[i];
+
+    vector<LogRecord> viaStd = records;
+    auto start = chrono::steady_clock::now();
+    sort(viaStd.begin(), viaStd.end(), [](const LogRecord& a, const LogRecord& b) { return a.line < b.line; });
+    double stdMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    vector<LogRecord> viaRecords = records;
+    start = chrono::steady_clock::now();
+    sortRecords(viaRecords, [](const LogRecord& r) -> const string& { return r.line; });
+    double recMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (viaStd[i].line != viaRecords[i].line) {
+            fprintf(stderr, "sortRecords produced wrong order\n");
+            return 1;
+        }
+    }
+    printf("\n%zu log records with a %zu-byte payload: std::sort %.1f ms, sortRecords %.1f ms\n",
+           records.size(), sizeof(LogRecord::payload), stdMs, recMs);
+    return 0;
+}
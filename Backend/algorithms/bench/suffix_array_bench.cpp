@@ -0,0 +1,100 @@
+// Checks SA-IS and Kasai against naive constructions on many small strings,
+// then compares indexed pattern search with rescanning the text (what kmp.cpp
+// and rabin_karp.cpp do per query) as the text grows.
+//
+//   g++ -std=c++20 -O2 bench/suffix_array_bench.cpp -o suffix_array_bench && ./suffix_array_bench
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "../suffix_array.h"
+
+using namespace std;
+
+bool checkSmall(mt19937& rng) {
+    NullTracer none;
+    for (int trial = 0; trial < 20000; ++trial) {
+        int n = rng() % 40;
+        char alphabet = 'a' + rng() % 4;
+        string text(n, 'a');
+        for (char& c : text) c = 'a' + rng() % (alphabet - 'a' + 1);
+
+        vector<int> expected(n);
+        for (int i = 0; i < n; ++i) expected[i] = i;
+        sort(expected.begin(), expected.end(), [&](int a, int b) { return text.compare(a, string::npos, text, b, string::npos) < 0; });
+        textindex::TextIndex index = textindex::TextIndex::build(text, none);
+        if (index.sa != expected) {
+            fprintf(stderr, "wrong suffix array for \"%s\"\n", text.c_str());
+            return false;
+        }
+        for (int i = 1; i < n; ++i) {
+            int a = expected[i - 1], b = expected[i], h = 0;
+            while (a + h < n && b + h < n && text[a + h] == text[b + h]) ++h;
+            if (index.lcp[i] != h) {
+                fprintf(stderr, "wrong LCP for \"%s\"\n", text.c_str());
+                return false;
+            }
+        }
+        string pattern = text.substr(rng() % (n + 1), rng() % 4);
+        auto range = index.find(pattern, none);
+        int count = 0;
+        for (size_t p = text.find(pattern); p != string::npos && !pattern.empty(); p = text.find(pattern, p + 1)) ++count;
+        if (!pattern.empty() && range.second - range.first != count) {
+            fprintf(stderr, "wrong count for \"%s\" in \"%s\"\n", pattern.c_str(), text.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+// Words from a small vocabulary, so patterns have realistic repeat counts.
+string corpus(size_t bytes, mt19937& rng) {
+    const char* words[] = {"the", "search", "index", "suffix", "array", "pattern", "text", "query", "engine",
+                           "corpus", "match", "count", "build", "lcp", "rank", "order", "string", "tree"};
+    string text;
+    while (text.size() < bytes) {
+        text += words[rng() % size(words)];
+        text += ' ';
+    }
+    text.resize(bytes);
+    return text;
+}
+
+int main() {
+    mt19937 rng(11);
+    if (!checkSmall(rng)) return 1;
+    printf("SA-IS, Kasai and search agree with naive on 20000 random strings\n\n");
+
+    NullTracer none;
+    vector<string> patterns = {"suffix array", "pattern text query", "lcp rank", "engine corpus match", "tree the"};
+    printf("%10s %10s %16s %16s\n", "text MB", "build ms", "indexed us/q", "rescan us/q");
+    for (size_t mb : {1, 8, 32}) {
+        string text = corpus(mb << 20, rng);
+        auto start = chrono::steady_clock::now();
+        textindex::TextIndex index = textindex::TextIndex::build(text, none);
+        double buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        const int rounds = 2000;
+        long long indexed = 0, rescanned = 0;
+        start = chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            auto range = index.find(patterns[r % patterns.size()], none);
+            indexed += range.second - range.first;
+        }
+        double indexedUs = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / rounds;
+
+        start = chrono::steady_clock::now();
+        for (const string& p : patterns)
+            for (size_t at = text.find(p); at != string::npos; at = text.find(p, at + 1)) ++rescanned;
+        double rescanUs = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / patterns.size();
+
+        if (indexed != rescanned * rounds / (long long)patterns.size()) {
+            fprintf(stderr, "indexed and rescanned counts differ\n");
+            return 1;
+        }
+        printf("%10zu %10.0f %16.2f %16.0f\n", mb, buildMs, indexedUs, rescanUs);
+    }
+    return 0;
+}
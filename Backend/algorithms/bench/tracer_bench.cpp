@@ -0,0 +1,117 @@
+// Compares the sorting.h algorithms instantiated with NullTracer against
+// hand-written copies that have no trace points at all. The two columns
+// should match to within noise; a gap means a trace point is doing work
+// that NullTracer does not compile away.
+//
+//   g++ -std=c++20 -O2 bench/tracer_bench.cpp -o tracer_bench && ./tracer_bench
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <vector>
+#include "../sorting.h"
+
+using namespace std;
+
+namespace plain {
+
+void bubbleSort(vector<int>& arr) {
+    int n = arr.size();
+    for (int i = 0; i < n - 1; ++i)
+        for (int j = 0; j < n - i - 1; ++j)
+            if (arr[j] > arr[j + 1]) swap(arr[j], arr[j + 1]);
+}
+
+void insertionSort(vector<int>& arr) {
+    int n = arr.size();
+    for (int i = 1; i < n; ++i) {
+        int key = arr[i];
+        int j = i - 1;
+        while (j >= 0 && arr[j] > key) {
+            arr[j + 1] = arr[j];
+            j--;
+        }
+        arr[j + 1] = key;
+    }
+}
+
+void quickSort(vector<int>& arr, int low, int high) {
+    if (low >= high) return;
+    int pivot = arr[high];
+    int i = low - 1;
+    for (int j = low; j < high; ++j)
+        if (arr[j] <= pivot && ++i != j) swap(arr[i], arr[j]);
+    swap(arr[i + 1], arr[high]);
+    quickSort(arr, low, i);
+    quickSort(arr, i + 2, high);
+}
+
+void mergeSort(vector<int>& arr, int left, int right) {
+    if (left == right) return;
+    int mid = left + (right - left) / 2;
+    mergeSort(arr, left, mid);
+    mergeSort(arr, mid + 1, right);
+    vector<int> leftArr(arr.begin() + left, arr.begin() + mid + 1);
+    vector<int> rightArr(arr.begin() + mid + 1, arr.begin() + right + 1);
+    int i = 0, j = 0, k = left;
+    while (i < (int)leftArr.size() && j < (int)rightArr.size())
+        arr[k++] = leftArr[i] <= rightArr[j] ? leftArr[i++] : rightArr[j++];
+    while (i < (int)leftArr.size()) arr[k++] = leftArr[i++];
+    while (j < (int)rightArr.size()) arr[k++] = rightArr[j++];
+}
+
+} // namespace plain
+
+double timeSort(const vector<int>& input, int reps, const function<void(vector<int>&)>& sort) {
+    double best = 1e300;
+    for (int r = 0; r < reps; ++r) {
+        vector<int> arr = input;
+        auto start = chrono::steady_clock::now();
+        sort(arr);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if (!is_sorted(arr.begin(), arr.end())) {
+            fprintf(stderr, "sort produced unsorted output\n");
+            exit(1);
+        }
+        best = min(best, ms);
+    }
+    return best;
+}
+
+vector<int> randomInput(int n) {
+    mt19937 rng(12345);
+    uniform_int_distribution<int> dist(0, 1000000);
+    vector<int> arr(n);
+    for (int& x : arr) x = dist(rng);
+    return arr;
+}
+
+int main() {
+    NullTracer none;
+    vector<int> small = randomInput(20000);
+    vector<int> large = randomInput(2000000);
+    int last = large.size() - 1;
+
+    struct Case {
+        const char* name;
+        const vector<int>& input;
+        function<void(vector<int>&)> traced;
+        function<void(vector<int>&)> untraced;
+    };
+    Case cases[] = {
+        {"bubble-sort",    small, [&](vector<int>& a) { bubbleSort(a, none); },    plain::bubbleSort},
+        {"insertion-sort", small, [&](vector<int>& a) { insertionSort(a, none); }, plain::insertionSort},
+        {"quick-sort",     large, [&](vector<int>& a) { quickSort(a, 0, last, 1, 0, none); },
+                                  [&](vector<int>& a) { plain::quickSort(a, 0, last); }},
+        {"merge-sort",     large, [&](vector<int>& a) { mergeSort(a, 0, last, 1, 0, none); },
+                                  [&](vector<int>& a) { plain::mergeSort(a, 0, last); }},
+    };
+
+    printf("%-16s %10s %14s %12s\n", "algorithm", "n", "NullTracer ms", "untraced ms");
+    for (const Case& c : cases) {
+        double traced = timeSort(c.input, 5, c.traced);
+        double untraced = timeSort(c.input, 5, c.untraced);
+        printf("%-16s %10zu %14.2f %12.2f\n", c.name, c.input.size(), traced, untraced);
+    }
+    return 0;
+}
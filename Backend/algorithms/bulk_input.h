@@ -0,0 +1,184 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <cstdio>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Bulk input over stdin for binaries started with --stdin-format=<format>.
+//
+// Instead of one argv entry per value, the whole input arrives on stdin:
+//
+//   i32, i64   raw little-endian integers, 4 or 8 bytes each
+//   text       numbers as text, separated by whitespace or commas
+//   utf8       UTF-8 text; how it splits into fields is up to the binary
+//
+// This avoids ARG_MAX, the per-argument string conversions on both sides,
+// and per-value stoi calls: integers are copied out of the input with one
+// memcpy, text numbers are parsed with std::from_chars, and text fields are
+// string_views into the input itself.
+//
+// When stdin is a regular file (a redirect, or a file in /dev/shm the caller
+// shares with us) it is mapped instead of read, so nothing is copied at all
+// until the algorithm needs its own array; a pipe is read in large chunks
+// into one buffer. On Windows stdin is switched to binary mode and always
+// read, never mapped.
+namespace bulk {
+
+enum class Format { None, I32, I64, Text, Utf8 };
+
+// Consumes --stdin-format=<format>; returns false if `option` is not it.
+inline bool parseFormatOption(const std::string& option, Format& format) {
+    if (option.rfind("--stdin-format=", 0) != 0) return false;
+    std::string name = option.substr(15);
+    if (name == "i32") format = Format::I32;
+    else if (name == "i64") format = Format::I64;
+    else if (name == "text") format = Format::Text;
+    else if (name == "utf8") format = Format::Utf8;
+    else throw std::invalid_argument("Unknown stdin format " + name + " (i32, i64, text or utf8)");
+    return true;
+}
+
+// All of stdin, mapped or read.
+class Input {
+public:
+    static Input readStdin() {
+        Input input;
+#ifdef _WIN32
+        // Stdin is opened in text mode, which would turn CRLF into LF inside
+        // packed integers.
+        _setmode(_fileno(stdin), _O_BINARY);
+        constexpr size_t kChunk = 1 << 20;
+        size_t used = 0;
+        for (;;) {
+            if (input.buffer_.size() < used + kChunk) input.buffer_.resize(std::max(used + kChunk, input.buffer_.size() * 2));
+            size_t got = std::fread(input.buffer_.data() + used, 1, input.buffer_.size() - used, stdin);
+            used += got;
+            if (got == 0) {
+                if (std::ferror(stdin)) throw std::runtime_error("Failed reading stdin");
+                break;
+            }
+        }
+#else
+        struct stat info;
+        if (fstat(STDIN_FILENO, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+            void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, STDIN_FILENO, 0);
+            if (mapped != MAP_FAILED) {
+                input.mapped_ = static_cast<const char*>(mapped);
+                input.size_ = info.st_size;
+                return input;
+            }
+        }
+        constexpr size_t kChunk = 1 << 20;
+        size_t used = 0;
+        for (;;) {
+            if (input.buffer_.size() < used + kChunk) input.buffer_.resize(std::max(used + kChunk, input.buffer_.size() * 2));
+            ssize_t got = read(STDIN_FILENO, input.buffer_.data() + used, input.buffer_.size() - used);
+            if (got < 0 && errno == EINTR) continue;
+            if (got < 0) throw std::runtime_error("Failed reading stdin");
+            if (got == 0) break;
+            used += got;
+        }
+#endif
+        input.buffer_.resize(used);
+        input.size_ = used;
+        return input;
+    }
+
+    Input(Input&& other) noexcept
+        : buffer_(std::move(other.buffer_)), mapped_(std::exchange(other.mapped_, nullptr)), size_(other.size_) {}
+    Input(const Input&) = delete;
+    Input& operator=(const Input&) = delete;
+    ~Input() {
+#ifndef _WIN32
+        if (mapped_) munmap(const_cast<char*>(mapped_), size_);
+#endif
+    }
+
+    std::string_view bytes() const { return {mapped_ ? mapped_ : buffer_.data(), size_}; }
+
+private:
+    Input() = default;
+
+    std::vector<char> buffer_;
+    const char* mapped_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Little-endian integers of T's width.
+template <class T>
+std::vector<T> decodeIntegers(std::string_view bytes) {
+    static_assert(std::is_integral_v<T>);
+    if (bytes.size() % sizeof(T) != 0) {
+        throw std::invalid_argument("Input is not a whole number of " + std::to_string(sizeof(T)) + "-byte integers");
+    }
+    std::vector<T> values(bytes.size() / sizeof(T));
+    std::memcpy(values.data(), bytes.data(), bytes.size());
+    if constexpr (std::endian::native == std::endian::big) {
+        for (T& v : values) {
+            auto* raw = reinterpret_cast<unsigned char*>(&v);
+            std::reverse(raw, raw + sizeof(T));
+        }
+    }
+    return values;
+}
+
+// One number; the whole of `text` must be the number.
+template <class T>
+T parseNumber(std::string_view text) {
+    T value{};
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc() || end != text.data() + text.size()) {
+        throw std::invalid_argument("not a valid number: " + std::string(text));
+    }
+    return value;
+}
+
+// Numbers separated by any run of whitespace and commas.
+template <class T>
+std::vector<T> parseNumbers(std::string_view text) {
+    auto separator = [](char c) { return c == ',' || c == ' ' || c == '\n' || c == '\t' || c == '\r'; };
+    std::vector<T> values;
+    size_t i = 0, n = text.size();
+    while (true) {
+        while (i < n && separator(text[i])) ++i;
+        if (i == n) break;
+        size_t start = i;
+        while (i < n && !separator(text[i])) ++i;
+        values.push_back(parseNumber<T>(text.substr(start, i - start)));
+    }
+    return values;
+}
+
+// Lines without their terminators (\n or \r\n); a final newline does not
+// start an empty last line.
+inline std::vector<std::string_view> splitLines(std::string_view text) {
+    std::vector<std::string_view> lines;
+    while (!text.empty()) {
+        size_t end = text.find('\n');
+        std::string_view line = text.substr(0, end);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        lines.push_back(line);
+        if (end == std::string_view::npos) break;
+        text.remove_prefix(end + 1);
+    }
+    return lines;
+}
+
+} // namespace bulk
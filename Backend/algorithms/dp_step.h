@@ -0,0 +1,25 @@
+#pragma once
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One step of a table-filling DP as the DP visualizer reads it: the cell
+// (row i, column w) just decided, how, its value, and the whole row so far.
+// Shared by knapsack and the sequence alignments, which draw the same way.
+inline std::string formatDpStep(int i, int w, std::string_view decision, int currentValue, const std::vector<int>& row) {
+    std::ostringstream out;
+    out << "{";
+    out << "\"step\": " << i << ", ";
+    out << "\"weight\": " << w << ", ";
+    out << "\"decision\": \"" << decision << "\", ";
+    out << "\"currentValue\": " << currentValue << ", ";
+    out << "\"dpRow\": [";
+    for (size_t k = 0; k < row.size(); ++k) {
+        if (k) out << ", ";
+        out << row[k];
+    }
+    out << "]";
+    out << "}";
+    return out.str();
+}
@@ -1,24 +1,28 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <sstream>
+#include "trace_writer.h"
 
 using namespace std;
 
 void logStep(int n, int result, const string& message, const vector<int>& prevIndices = {}) {
-    cout << "{";
-    cout << "\"type\":\"Fibonacci\", ";
-    cout << "\"n\":" << n << ", ";
-    cout << "\"result\":" << result << ", ";
-    cout << "\"message\":\"" << message << "\"";
+    ostringstream out;
+    out << "{";
+    out << "\"type\":\"Fibonacci\", ";
+    out << "\"n\":" << n << ", ";
+    out << "\"result\":" << result << ", ";
+    out << "\"message\":\"" << message << "\"";
     if (!prevIndices.empty()) {
-        cout << ", \"prevIndices\": [";
+        out << ", \"prevIndices\": [";
         for (int i = 0; i < prevIndices.size(); ++i) {
-            cout << prevIndices[i];
-            if (i + 1 < prevIndices.size()) cout << ",";
+            out << prevIndices[i];
+            if (i + 1 < prevIndices.size()) out << ",";
         }
-        cout << "]";
+        out << "]";
     }
-    cout << "}" << endl;
+    out << "}";
+    trace::emit(out.str());
 }
 
 int fibonacci(int n) {
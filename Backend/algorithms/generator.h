@@ -0,0 +1,87 @@
+#pragma once
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <utility>
+
+// Minimal C++20 generator: a coroutine that produces one value per co_yield
+// and stays suspended until the consumer asks for the next one. Nothing runs
+// before the first begin() and nothing runs after the generator is destroyed,
+// so a caller that stops pulling pays nothing for the remaining steps.
+//
+// Recursive algorithms forward a child generator with
+//     for (const auto& step : child(...)) co_yield step;
+template <class T>
+class Generator {
+public:
+    struct promise_type {
+        const T* current = nullptr;
+        std::exception_ptr error;
+
+        Generator get_return_object() {
+            return Generator{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        // The yielded object outlives the suspension, so pointing at it is safe.
+        std::suspend_always yield_value(const T& value) noexcept {
+            current = std::addressof(value);
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    using Handle = std::coroutine_handle<promise_type>;
+
+    struct Sentinel {};
+
+    class Iterator {
+    public:
+        explicit Iterator(Handle handle) : handle_(handle) {}
+
+        const T& operator*() const { return *handle_.promise().current; }
+        const T* operator->() const { return handle_.promise().current; }
+
+        Iterator& operator++() {
+            advance(handle_);
+            return *this;
+        }
+
+        bool operator==(Sentinel) const { return !handle_ || handle_.done(); }
+        bool operator!=(Sentinel s) const { return !(*this == s); }
+
+    private:
+        Handle handle_;
+    };
+
+    explicit Generator(Handle handle) : handle_(handle) {}
+    Generator(Generator&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Generator& operator=(Generator&& other) noexcept {
+        if (this != &other) {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+    ~Generator() {
+        if (handle_) handle_.destroy();
+    }
+
+    // Runs the coroutine up to its first co_yield. Call once per generator.
+    Iterator begin() {
+        advance(handle_);
+        return Iterator{handle_};
+    }
+    Sentinel end() const { return {}; }
+
+private:
+    static void advance(Handle handle) {
+        handle.resume();
+        if (handle.promise().error) std::rethrow_exception(handle.promise().error);
+    }
+
+    Handle handle_;
+};
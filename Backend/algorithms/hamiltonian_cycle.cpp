@@ -1,68 +1,94 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <sstream>
+#include "trace_writer.h"
+#include "step_session.h"
 
 using namespace std;
 
 void logStep(const vector<vector<int>>& graph, const vector<int>& path, int vertex, const string& message) {
-    cout << "{";
-    cout << "\"type\":\"Hamiltonian Cycle\", ";
-    cout << "\"message\":\"" << message << "\", ";
-    cout << "\"graph\":[";
+    ostringstream out;
+    out << "{";
+    out << "\"type\":\"Hamiltonian Cycle\", ";
+    out << "\"message\":\"" << message << "\", ";
+    out << "\"graph\":[";
 
     for (int i = 0; i < graph.size(); ++i) {
-        cout << "[";
+        out << "[";
         for (int j = 0; j < graph[i].size(); ++j) {
-            cout << graph[i][j];
-            if (j != graph[i].size() - 1) cout << ", ";
+            out << graph[i][j];
+            if (j != graph[i].size() - 1) out << ", ";
         }
-        cout << "]";
-        if (i != graph.size() - 1) cout << ", ";
+        out << "]";
+        if (i != graph.size() - 1) out << ", ";
     }
 
-    cout << "], \"path\": [";
+    out << "], \"path\": [";
     for (int i = 0; i < path.size(); ++i) {
-        cout << path[i];
-        if (i != path.size() - 1) cout << ", ";
+        out << path[i];
+        if (i != path.size() - 1) out << ", ";
     }
-    cout << "], \"vertex\": " << vertex;
-    cout << "}" << endl;
+    out << "], \"vertex\": " << vertex;
+    out << "}";
+    trace::emit(out.str());
 }
 
+// One step of the search; the path is read when the step is emitted, while
+// hamCycleUtil() is suspended at the yield.
+struct PathStep {
+    string message;
+    int vertex;
+
+    // A real constructor rather than aggregate init: GCC 12 double-destroys
+    // aggregate temporaries passed to co_yield.
+    PathStep(string message, int vertex) : message(std::move(message)), vertex(vertex) {}
+};
+
 bool isSafe(int v, const vector<vector<int>>& graph, const vector<int>& path, int pos) {
     if (graph[path[pos - 1]][v] == 0) return false;
     for (int i = 0; i < pos; ++i) if (path[i] == v) return false;
     return true;
 }
 
-bool hamCycleUtil(const vector<vector<int>>& graph, vector<int>& path, int pos) {
+Generator<PathStep> hamCycleUtil(const vector<vector<int>>& graph, vector<int>& path, int pos, bool& found) {
     if (pos == graph.size()) {
         if (graph[path[pos - 1]][path[0]] == 1) {
-            logStep(graph, path, -1, " Hamiltonian Cycle found");
-            return true;
+            found = true;
+            co_yield PathStep(" Hamiltonian Cycle found", -1);
         } else {
-            logStep(graph, path, -1, "No cycle, backtracking");
-            return false;
+            co_yield PathStep("No cycle, backtracking", -1);
         }
+        co_return;
     }
 
     for (int v = 1; v < graph.size(); ++v) {
         if (isSafe(v, graph, path, pos)) {
             path[pos] = v;
-            logStep(graph, path, v, "Trying vertex " + to_string(v));
-            if (hamCycleUtil(graph, path, pos + 1)) return true;
+            co_yield PathStep("Trying vertex " + to_string(v), v);
+            for (const auto& step : hamCycleUtil(graph, path, pos + 1, found)) co_yield step;
+            if (found) co_return;
             path[pos] = -1;
-            logStep(graph, path, v, "Backtracking from vertex " + to_string(v));
+            co_yield PathStep("Backtracking from vertex " + to_string(v), v);
         }
     }
-    return false;
 }
 
-void findHamiltonianCycle(const vector<vector<int>>& graph) {
+void findHamiltonianCycle(const vector<vector<int>>& graph, bool stepMode) {
     vector<int> path(graph.size(), -1);
     path[0] = 0;
     logStep(graph, path, 0, "Starting Hamiltonian cycle search");
-    if (!hamCycleUtil(graph, path, 1)) {
+
+    bool found = false;
+    auto steps = hamCycleUtil(graph, path, 1, found);
+    auto emit = [&](const PathStep& step) { logStep(graph, path, step.vertex, step.message); };
+    if (stepMode) {
+        if (!serveSteps(steps, emit)) return;
+    } else {
+        for (const auto& step : steps) emit(step);
+    }
+
+    if (!found) {
         logStep(graph, path, -1, "No Hamiltonian Cycle found");
     }
 }
@@ -83,9 +109,9 @@ int main(int argc, char* argv[]) {
         
     };
     
-    if (argc > 1) {
-    }
+    // --step: advance only as far as the client asks (see step_session.h)
+    bool stepMode = argc > 1 && string(argv[1]) == "--step";
 
-    findHamiltonianCycle(graph);
+    findHamiltonianCycle(graph, stepMode);
     return 0;
 }
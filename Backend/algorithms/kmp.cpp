@@ -1,25 +1,63 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include "trace_writer.h"
+#include "tracer.h"
+#include "batch.h"
+#include "bulk_input.h"
+#include "session_state.h"
 using namespace std;
 
-void logStep(const string& text,
-             const string& pattern,
-             int l,
-             int r,
-             const string& message) {
-    cout << "{";
-    cout << "\"type\":\"KMP\", ";
-    if (l >= 0)     cout << "\"l\":"       << l       << ", ";
-    if (r >= 0)     cout << "\"r\":"       << r       << ", ";
-    cout << "\"text\":\""    << text    << "\", ";
-    cout << "\"pattern\":\"" << pattern << "\", ";
-    cout << "\"message\":\"" << message << "\"";
-    cout << "}" << endl;
+string formatStep(string_view text,
+                  string_view pattern,
+                  int l,
+                  int r,
+                  const string& message) {
+    ostringstream out;
+    out << "{";
+    out << "\"type\":\"KMP\", ";
+    if (l >= 0)     out << "\"l\":"       << l       << ", ";
+    if (r >= 0)     out << "\"r\":"       << r       << ", ";
+    out << "\"text\":"       << jsonString(text)    << ", ";
+    out << "\"pattern\":"    << jsonString(pattern) << ", ";
+    out << "\"message\":\"" << message << "\"";
+    out << "}";
+    return out.str();
 }
 
-void lpsarray(const string& pattern,
-                     vector<int>& lps) {
+void logStep(string_view text, string_view pattern, int l, int r, const string& message) {
+    trace::emit(formatStep(text, pattern, l, r, message));
+}
+
+// Streams every step to the visualizer.
+struct StreamTracer {
+    static constexpr bool enabled = true;
+
+    template <class Message>
+    void step(string_view text, string_view pattern, int l, int r, Message&& message) {
+        logStep(text, pattern, l, r, message());
+    }
+};
+
+// Collects the steps of one batch input instead of streaming them.
+struct BufferedTracer {
+    static constexpr bool enabled = true;
+    StepBuffer& steps;
+
+    template <class Message>
+    void step(string_view text, string_view pattern, int l, int r, Message&& message) {
+        steps.add(formatStep(text, pattern, l, r, message()));
+    }
+};
+
+template <class Tracer>
+void lpsarray(string_view pattern,
+                     vector<int>& lps,
+                     Tracer& trace) {
     int length = 0;
     lps[0] = 0;
     int i = 1;
@@ -29,39 +67,44 @@ void lpsarray(const string& pattern,
             length++;
             lps[i] = length;
             i++;
-            logStep(/*text=*/pattern,
-                    pattern,
-                    /*l=*/i,
-                    /*r=*/length,
-                    "LPS Updated");
+            trace.step(/*text=*/pattern,
+                       pattern,
+                       /*l=*/i,
+                       /*r=*/length,
+                       [] { return "LPS Updated"; });
         } else {
             if (length != 0) {
                 length = lps[length - 1];
             } else {
                 lps[i] = 0;
                 i++;
-                logStep(/*text=*/pattern,
-                        pattern,
-                        /*l=*/i,
-                        /*r=*/length,
-                        "LPS Updated");
+                trace.step(/*text=*/pattern,
+                           pattern,
+                           /*l=*/i,
+                           /*r=*/length,
+                           [] { return "LPS Updated"; });
             }
         }
     }
 }
 
-void KMPSearch(const string& text, const string& pattern) {
+// Text positions between the search states a session keeps.
+constexpr int kCheckpointEvery = 64;
+
+// The search loop, from text index i with j pattern characters matched.
+// Returns the index of the first match, or -1; i is left where the search
+// stopped. With `checkpoints`, j is recorded each time i first reaches a
+// multiple of kCheckpointEvery, which is all it takes to resume from there.
+template <class Tracer>
+int scanText(string_view text, string_view pattern, const vector<int>& lps, int& i, int j, Tracer& trace,
+             vector<int>* checkpoints = nullptr) {
     int n = text.size();
     int m = pattern.size();
 
-    vector<int> lps(m);
-    lpsarray(pattern, lps);
-
-    int i = 0;  // index for text
-    int j = 0;  // index for pattern
-    logStep(text, pattern, /*l=*/-1, /*r=*/-1, "Starting KMP Search");
     while (i < n) {
-        logStep(text, pattern, /*l=*/i, /*r=*/j, "Matching characters");
+        if (checkpoints && i % kCheckpointEvery == 0 && i / kCheckpointEvery == (int)checkpoints->size())
+            checkpoints->push_back(j);
+        trace.step(text, pattern, /*l=*/i, /*r=*/j, [] { return "Matching characters"; });
 
         if (pattern[j] == text[i]) {
             i++;
@@ -70,38 +113,205 @@ void KMPSearch(const string& text, const string& pattern) {
 
         if (j == m) {
           
-            logStep(text, pattern,
-                    i - j,
-                    j,
-                    "Pattern found at index " + to_string(i - j));
-            return;
+            trace.step(text, pattern,
+                       i - j,
+                       j,
+                       [&] { return "Pattern found at index " + to_string(i - j); });
+            return i - j;
         } else if (i < n && pattern[j] != text[i]) {
             if (j != 0) {
                 j = lps[j - 1];
-                logStep(text, pattern,
-                        /*l=*/i,
-                        /*r=*/j,
-                        "Mismatch, jumping to index " + to_string(j));
+                trace.step(text, pattern,
+                           /*l=*/i,
+                           /*r=*/j,
+                           [&] { return "Mismatch, jumping to index " + to_string(j); });
             } else {
                 i++;
-                logStep(text, pattern,
-                        /*l=*/i,
-                        /*r=*/j,
-                        "Mismatch, moving to next character");
+                trace.step(text, pattern,
+                           /*l=*/i,
+                           /*r=*/j,
+                           [] { return "Mismatch, moving to next character"; });
             }
         }
     }
 
-    logStep(text, pattern, /*l=*/-1, /*r=*/-1, "Pattern not found");
+    trace.step(text, pattern, /*l=*/-1, /*r=*/-1, [] { return "Pattern not found"; });
+    return -1;
+}
+
+// Returns the index of the first match, or -1.
+template <class Tracer>
+int KMPSearch(string_view text, string_view pattern, Tracer& trace) {
+    vector<int> lps(pattern.size());
+    lpsarray(pattern, lps, trace);
+
+    int i = 0;
+    trace.step(text, pattern, /*l=*/-1, /*r=*/-1, [] { return "Starting KMP Search"; });
+    return scanText(text, pattern, lps, i, 0, trace);
+}
+
+constexpr uint32_t kSessionMagic = 0x31504d4b;  // "KMP1"
+
+// What a session run keeps: the inputs, the LPS table, the search states at
+// every kCheckpointEvery text positions it reached, and the result.
+struct KmpSession {
+    string text, pattern;
+    vector<int> lps, checkpoints;
+    int result = -1;
+
+    static bool load(const string& file, KmpSession& s) {
+        session::Reader in(file, kSessionMagic);
+        in.text(s.text);
+        in.text(s.pattern);
+        in.array(s.lps);
+        in.array(s.checkpoints);
+        in.value(s.result);
+        return in.ok() && s.lps.size() == s.pattern.size();
+    }
+
+    bool save(const string& file) const {
+        session::Writer out(file, kSessionMagic);
+        out.text(text);
+        out.text(pattern);
+        out.array(lps);
+        out.array(checkpoints);
+        out.value(result);
+        return out.commit();
+    }
+};
+
+// KMPSearch against the previous run in `file`. An unchanged pattern keeps
+// its LPS table. Text before the first edit is not searched again: a match
+// that ends before the edit still stands, and otherwise the search resumes
+// from the last checkpoint before it. Work is counted in characters: the
+// pattern when its table is built, plus the text positions scanned.
+template <class Tracer>
+int KMPSearchSession(const string& file, string_view text, string_view pattern, Tracer& trace) {
+    KmpSession old;
+    bool resumed = KmpSession::load(file, old) && old.pattern == pattern;
+    int m = pattern.size();
+
+    KmpSession now;
+    now.text = text;
+    now.pattern = pattern;
+    uint64_t work = 0;
+    if (resumed) {
+        now.lps = move(old.lps);
+        trace.step(pattern, pattern, /*l=*/-1, /*r=*/-1, [] { return "Pattern unchanged, reusing LPS table"; });
+    } else {
+        now.lps.resize(m);
+        lpsarray(pattern, now.lps, trace);
+        work += m;
+    }
+
+    int edit = 0;  // first index where the text differs from the last run's
+    if (resumed) {
+        size_t common = min(text.size(), old.text.size());
+        while (edit < (int)common && text[edit] == old.text[edit]) ++edit;
+        if (text.size() == old.text.size() && edit == (int)common) edit = text.size() + 1;
+    }
+
+    if (resumed && old.result != -1 && old.result + m <= edit) {
+        now.result = old.result;
+        now.checkpoints = move(old.checkpoints);
+        trace.step(text, pattern, old.result, m,
+                   [&] { return "Match at index " + to_string(old.result) + " ends before the first edit"; });
+    } else {
+        int i = 0, j = 0;
+        if (resumed && !old.checkpoints.empty()) {
+            size_t c = min<size_t>(min(edit, (int)text.size()) / kCheckpointEvery, old.checkpoints.size() - 1);
+            i = c * kCheckpointEvery;
+            j = old.checkpoints[c];
+            old.checkpoints.resize(c);
+            now.checkpoints = move(old.checkpoints);
+        }
+        trace.step(text, pattern, /*l=*/-1, /*r=*/-1,
+                   [&] { return i ? "Text unchanged before index " + to_string(i) + ", resuming KMP Search"
+                                  : string("Starting KMP Search"); });
+        int from = i;
+        now.result = scanText(text, pattern, now.lps, i, j, trace, &now.checkpoints);
+        work += i - from;
+    }
+
+    if (!now.save(file)) cerr << "Could not save session to " << file << endl;
+    session::reportWork("characters", work, m + (now.result == -1 ? text.size() : now.result + m));
+    return now.result;
+}
+
+// One input per stdin line: text and pattern separated by a tab. Each frame's
+// result is the index of the first match, or -1.
+int runSearchBatch(const BatchOptions& batch) {
+    return runBatch(batch, [](const vector<string>& fields, StepBuffer* steps) {
+        if (fields.size() != 2 || fields[1].empty()) throw invalid_argument("Expected text and a non-empty pattern.");
+        int index;
+        if (steps) {
+            BufferedTracer tracer{*steps};
+            index = KMPSearch(fields[0], fields[1], tracer);
+        } else {
+            NullTracer tracer;
+            index = KMPSearch(fields[0], fields[1], tracer);
+        }
+        return to_string(index);
+    });
+}
+
+// --stdin-format=utf8: the pattern is the first line of stdin and the text
+// everything after it, newlines included; both are views into the input.
+bool splitStdin(const bulk::Input& input, string_view& text, string_view& pattern) {
+    string_view bytes = input.bytes();
+    size_t end = bytes.find('\n');
+    if (end == string_view::npos) return false;
+    pattern = bytes.substr(0, end);
+    text = bytes.substr(end + 1);
+    return true;
 }
 
 int main(int argc, char* argv[]) {
-    string text    = "auntymomos";
-    string pattern = "momo";
+    BatchOptions batch;
+    bulk::Format format = bulk::Format::None;
+    string sessionFile;
+    try {
+        while (argc > 1 && (parseBatchOption(argv[1], batch) || bulk::parseFormatOption(argv[1], format) ||
+                            session::parseSessionOption(argv[1], sessionFile))) {
+            ++argv;
+            --argc;
+        }
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    if (format != bulk::Format::None && (format != bulk::Format::Utf8 || batch.enabled)) {
+        cerr << "Only --stdin-format=utf8 is supported, and not with --batch." << endl;
+        return 1;
+    }
+    if (batch.enabled && !sessionFile.empty()) {
+        cerr << "--session cannot be combined with --batch." << endl;
+        return 1;
+    }
+    if (batch.enabled) return runSearchBatch(batch);
+
+    string_view text = "auntymomos";
+    string_view pattern = "momo";
 
-    if (argc > 1) text    = argv[1];
-    if (argc > 2) pattern = argv[2];
+    optional<bulk::Input> input;
+    if (format == bulk::Format::Utf8) {
+        input.emplace(bulk::Input::readStdin());
+        if (!splitStdin(*input, text, pattern)) {
+            cerr << "Expected the pattern on the first line of stdin." << endl;
+            return 1;
+        }
+    } else {
+        if (argc > 1) text    = argv[1];
+        if (argc > 2) pattern = argv[2];
+    }
+    // Like the batch path, refuse an empty pattern: the searches index pattern[0].
+    if (pattern.empty()) {
+        cerr << "Expected a non-empty pattern." << endl;
+        return 1;
+    }
 
-    KMPSearch(text, pattern);
+    SelectedTracer<StreamTracer> tracer;
+    if (sessionFile.empty()) KMPSearch(text, pattern, tracer);
+    else KMPSearchSession(sessionFile, text, pattern, tracer);
     return 0;
 }
@@ -1,72 +1,239 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <sstream>
+#include <stdexcept>
+#include "trace_writer.h"
+#include "tracer.h"
+#include "batch.h"
+#include "session_state.h"
+#include "dp_step.h"
 
 using namespace std;
 
+string formatStep(int i, int w, const string& decision, int currentValue, const vector<vector<int>>& dp) {
+    return formatDpStep(i, w, decision, currentValue, dp[i]);
+}
+
 void printStep(int i, int w, const string& decision, int currentValue, const vector<vector<int>>& dp) {
-    cout << "{";
-    cout << "\"step\": " << i << ", ";
-    cout << "\"weight\": " << w << ", ";
-    cout << "\"decision\": \"" << decision << "\", ";
-    cout << "\"currentValue\": " << currentValue << ", ";
-    cout << "\"dpRow\": [";
-    for (int j = 0; j < dp[i].size(); ++j) {
-        cout << dp[i][j];
-        if (j < dp[i].size() - 1) cout << ", ";
+    trace::emit(formatStep(i, w, decision, currentValue, dp));
+}
+
+// Streams every step to the visualizer.
+struct StreamTracer {
+    static constexpr bool enabled = true;
+
+    void step(int i, int w, const char* decision, int currentValue, const vector<vector<int>>& dp) {
+        printStep(i, w, decision, currentValue, dp);
+    }
+};
+
+// Collects the steps of one batch input instead of streaming them.
+struct BufferedTracer {
+    static constexpr bool enabled = true;
+    StepBuffer& steps;
+
+    void step(int i, int w, const char* decision, int currentValue, const vector<vector<int>>& dp) {
+        steps.add(formatStep(i, w, decision, currentValue, dp));
+    }
+};
+
+// Fills dp[i][from..to]; row i - 1 must be complete up to column `to`.
+template <class Tracer>
+void fillRow(int i, int from, int to, const vector<int>& weights, const vector<int>& values, vector<vector<int>>& dp, Tracer& trace) {
+    for (int w = from; w <= to; ++w) {
+        if (weights[i - 1] <= w) {
+            int include = values[i - 1] + dp[i - 1][w - weights[i - 1]];
+            int exclude = dp[i - 1][w];
+            dp[i][w] = max(include, exclude);
+            trace.step(i, w, (include > exclude ? "include" : "exclude"), dp[i][w], dp);
+        } else {
+            dp[i][w] = dp[i - 1][w];
+            trace.step(i, w, "exclude", dp[i][w], dp);
+        }
     }
-    cout << "]";
-    cout << "}" << endl;
 }
 
-int knapsack(int W, const vector<int>& weights, const vector<int>& values) {
+template <class Tracer>
+int knapsack(int W, const vector<int>& weights, const vector<int>& values, Tracer& trace) {
     int n = weights.size();
-    vector<vector<int>> dp(n, vector<int>(W , 0));
+    vector<vector<int>> dp(n + 1, vector<int>(W + 1, 0));
 
-    for (int i = 1; i <= n; ++i) {
-        for (int w = 0; w <= W; ++w) {
-            if (weights[i - 1] <= w) {
-                int include = values[i - 1] + dp[i - 1][w - weights[i - 1]];
-                int exclude = dp[i - 1][w];
-                dp[i][w] = max(include, exclude);
-                printStep(i, w, (include > exclude ? "include" : "exclude"), dp[i][w], dp);
-            } else {
-                dp[i][w] = dp[i - 1][w];
-                printStep(i, w, "exclude", dp[i][w], dp);
-            }
+    for (int i = 1; i <= n; ++i) fillRow(i, 0, W, weights, values, dp, trace);
+
+    return dp[n][W];
+}
+
+// Session mode: dp[i][w] depends only on the first i items and on columns up
+// to w, so after an edit the previous table is still right for every row
+// before the first changed item and every column up to the smaller of the two
+// capacities. Only the rest is recomputed.
+constexpr uint32_t kSessionMagic = 0x3150534b;  // "KSP1"
+
+struct KnapsackSession {
+    int W = -1;
+    vector<int> weights, values;
+    vector<vector<int>> dp;
+
+    static KnapsackSession load(const string& file) {
+        KnapsackSession state;
+        session::Reader in(file, kSessionMagic);
+        vector<int> cells;
+        in.value(state.W);
+        in.array(state.weights);
+        in.array(state.values);
+        in.array(cells);
+        size_t rows = state.weights.size() + 1;
+        if (!in.ok() || state.W < 0 || state.values.size() != state.weights.size() || cells.size() != rows * (state.W + 1)) {
+            return {};
         }
+        for (size_t i = 0; i < rows; ++i) {
+            state.dp.emplace_back(cells.begin() + i * (state.W + 1), cells.begin() + (i + 1) * (state.W + 1));
+        }
+        return state;
     }
 
-    cout << "{\"finalValue\": " << dp[n][W] << "}" << endl;
-    return dp[n][W];
+    void save(const string& file) const {
+        session::Writer out(file, kSessionMagic);
+        vector<int> cells;
+        for (const auto& row : dp) cells.insert(cells.end(), row.begin(), row.end());
+        out.value(W);
+        out.array(weights);
+        out.array(values);
+        out.array(cells);
+        if (!out.commit()) cerr << "Could not save session to " << file << endl;
+    }
+};
+
+template <class Tracer>
+int knapsackSession(const string& file, int W, const vector<int>& weights, const vector<int>& values, Tracer& trace) {
+    int n = weights.size();
+    KnapsackSession state = KnapsackSession::load(file);
+
+    // Rows 1..same hold items the previous run had in the same places.
+    int same = 0;
+    int sharedW = state.W < 0 ? -1 : min(W, state.W);
+    if (sharedW >= 0) {
+        int limit = min<int>(n, state.weights.size());
+        while (same < limit && state.weights[same] == weights[same] && state.values[same] == values[same]) ++same;
+    }
+
+    vector<vector<int>> dp(n + 1, vector<int>(W + 1, 0));
+    for (int i = 1; i <= same; ++i) {
+        copy(state.dp[i].begin(), state.dp[i].begin() + sharedW + 1, dp[i].begin());
+        trace.step(i, -1, "reused", dp[i][sharedW], dp);
+    }
+
+    uint64_t work = 0;
+    for (int i = 1; i <= n; ++i) {
+        int from = i <= same ? sharedW + 1 : 0;
+        fillRow(i, from, W, weights, values, dp, trace);
+        work += W + 1 - from;
+    }
+    session::reportWork("cells", work, (uint64_t)n * (W + 1));
+
+    state.W = W;
+    state.weights = weights;
+    state.values = values;
+    state.dp = move(dp);
+    state.save(file);
+    return state.dp[n][W];
+}
+
+int toInt(const string& text) {
+    try {
+        return stoi(text);
+    } catch (const logic_error&) {
+        throw invalid_argument("Not a number: " + text);
+    }
 }
 
 vector<int> parseArgs(int argc, char* argv[], int start, int count) {
     vector<int> result;
     for (int i = start; i < start + count && i < argc; ++i) {
-        result.push_back(stoi(argv[i]));
+        result.push_back(toInt(argv[i]));
     }
     return result;
 }
 
+// fillRow indexes dp[i - 1][w - weight], so a negative weight would read past
+// the end of the row; negative capacities and values are refused with them.
+void checkItems(int W, const vector<int>& weights, const vector<int>& values) {
+    if (W < 0) throw invalid_argument("Capacity must not be negative.");
+    for (size_t i = 0; i < weights.size(); ++i) {
+        if (weights[i] < 0 || values[i] < 0) throw invalid_argument("Weights and values must not be negative.");
+    }
+}
+
+// One input per stdin line: capacity, item count, the weights, then the
+// values, separated by tabs. Each frame's result is the best total value.
+int runKnapsackBatch(const BatchOptions& batch) {
+    return runBatch(batch, [](const vector<string>& fields, StepBuffer* steps) {
+        if (fields.size() < 2) throw invalid_argument("Expected capacity and item count.");
+        int W = toInt(fields[0]);
+        int itemCount = toInt(fields[1]);
+        if (W < 0 || itemCount < 0 || (size_t)itemCount > (fields.size() - 2) / 2) {
+            throw invalid_argument("Not enough fields for weights and values.");
+        }
+        vector<int> weights, values;
+        for (int i = 0; i < itemCount; ++i) {
+            weights.push_back(toInt(fields[2 + i]));
+            values.push_back(toInt(fields[2 + itemCount + i]));
+        }
+        checkItems(W, weights, values);
+
+        int best;
+        if (steps) {
+            BufferedTracer tracer{*steps};
+            best = knapsack(W, weights, values, tracer);
+        } else {
+            NullTracer tracer;
+            best = knapsack(W, weights, values, tracer);
+        }
+        return to_string(best);
+    });
+}
+
 int main(int argc, char* argv[]) {
+    BatchOptions batch;
+    string sessionFile;
+    try {
+        while (argc > 1 && (parseBatchOption(argv[1], batch) || session::parseSessionOption(argv[1], sessionFile))) {
+            ++argv;
+            --argc;
+        }
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    if (batch.enabled) return runKnapsackBatch(batch);
+
     int W = 10;
     vector<int> weights = {2, 3, 4, 5};
     vector<int> values = {3, 4, 5, 6};
 
-    if (argc > 3) {
-        W = stoi(argv[1]);
-        int itemCount = stoi(argv[2]);
-        if (argc >= 3 + 2 * itemCount) {
-            weights = parseArgs(argc, argv, 3, itemCount);
-            values = parseArgs(argc, argv, 3 + itemCount, itemCount);
-        } else {
-            cerr << " Not enough arguments for weights and values." << endl;
-            return 1;
+    try {
+        if (argc > 3) {
+            W = toInt(argv[1]);
+            int itemCount = toInt(argv[2]);
+            if (itemCount >= 0 && itemCount <= (argc - 3) / 2) {
+                weights = parseArgs(argc, argv, 3, itemCount);
+                values = parseArgs(argc, argv, 3 + itemCount, itemCount);
+            } else {
+                cerr << " Not enough arguments for weights and values." << endl;
+                return 1;
+            }
         }
+        checkItems(W, weights, values);
+    } catch (const invalid_argument& e) {
+        cerr << e.what() << endl;
+        return 1;
     }
-    cout << "{\"action\": \"start\", \"maxWeight\": " << W << ", \"items\": " << weights.size() << "}" << endl;
-    knapsack(W, weights, values);
-    cout << "{\"action\": \"end\"}" << endl;
+    trace::emit("{\"action\": \"start\", \"maxWeight\": " + to_string(W) + ", \"items\": " + to_string(weights.size()) + "}");
+    SelectedTracer<StreamTracer> tracer;
+    int best = sessionFile.empty() ? knapsack(W, weights, values, tracer)
+                                   : knapsackSession(sessionFile, W, weights, values, tracer);
+    trace::emit("{\"finalValue\": " + to_string(best) + "}");
+    trace::emit("{\"action\": \"end\"}");
     return 0;
 }
\ No newline at end of file
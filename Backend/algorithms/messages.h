@@ -0,0 +1,97 @@
+#pragma once
+#include <cstdint>
+
+// Step messages as data.
+//
+// A step carries a message ID and up to four integer arguments instead of
+// finished text, so reporting a step builds no strings. messages.json maps
+// every ID to its template and is loaded once by the frontend, which fills
+// the templates in:
+//
+//   {k}        argument k
+//   {[k]}      the element at index (argument k) of the step's array
+//   {k:char}   argument k as a character, or "end" if it is negative
+//
+// IDs are positions in messages.json: only append, never renumber.
+namespace msg {
+
+enum Id : uint16_t {
+    // Sorting (sorting.h, string_sort.h)
+    InitialArray,       // Initial array
+    FinalArray,         // Final sorted array
+    SingleElement,      // Single element, no need to sort
+    SelectPivot,        // Selecting pivot {[0]} at index {0}
+    Swap,               // Swapping {[0]} and {[1]}
+    PlacePivot,         // Placing pivot at correct position
+    Merged,             // Merged from {0} to {1}
+    CannotSplit,        // An array of length 1 cannot be split, ready for merge
+    Splitting,          // Splitting
+    Compare,            // Comparing {[0]} and {[1]}
+    NoSwap,             // No swap needed
+    CompareMin,         // Comparing {[0]} with current min {[1]}
+    Shift,              // Shifting {[0]} to right
+    Insert,             // Inserting {[0]} at position {0}
+    Count,              // Counting element {[0]}
+    PrefixSum,          // Building prefix sum at index {0}
+    Place,              // Placing {0} at correct position
+    Digit,              // {[0]} has digit {1} at exp {2}
+    DigitPrefixSum,     // Building prefix sum for digit {0}
+    PlaceByDigit,       // Placing {0} based on digit {1}
+    InsertionSorted,    // Insertion sorted {0} strings from character {1}
+    Distributed,        // Distributed {0} strings into buckets by character {1}
+    Partitioned,        // Partitioned on character {0} around '{1:char}'
+    LcpMerged,          // Merged {0} to {1} using common prefixes
+
+    // Shortest paths and spanning trees (shortest_path.h, Greedy.cpp)
+    ChooseNode,         // Choosing node {0} with dist={1}
+    StaleEntry,         // Skipping stale entry for node {0}
+    VisitNode,          // Visiting node {0}
+    TargetSettled,      // Target {0} settled, stopping early
+    ConsiderEdge,       // Considering edge {0}->{1} (w={2})
+    UpdateDist,         // Updated dist[{0}]={1}
+    ForwardChoose,      // Forward: choosing node {0} with dist={1}
+    BackwardChoose,     // Backward: choosing node {0} with dist={1}
+    ForwardStale,       // Forward: skipping stale entry for node {0}
+    BackwardStale,      // Backward: skipping stale entry for node {0}
+    ForwardVisit,       // Forward: visiting node {0}
+    BackwardVisit,      // Backward: visiting node {0}
+    ForwardConsider,    // Forward: considering edge {0}->{1} (w={2})
+    BackwardConsider,   // Backward: considering edge {0}->{1} (w={2})
+    ForwardUpdate,      // Forward: updated dist[{0}]={1}
+    BackwardUpdate,     // Backward: updated dist[{0}]={1}
+    SearchesMeet,       // Searches meet at node {0}, path cost {1}
+    FrontiersStop,      // Frontiers cannot improve cost {0}, stopping early
+    PrimChoose,         // Choosing node {0} with key={1}
+    PrimSkip,           // Skipping node already in MST {0}
+    PrimInclude,        // Include node {0} with connecting cost={1}
+    PrimUpdate,         // Update key[{0}]={1}
+    KruskalConsider,    // Considering edge {0}-{1} (w={2})
+    KruskalSkip,        // Skipping edge {0}-{1} (would form cycle)
+    KruskalInclude,     // Kruskal: include edge {0}-{1} (w={2})
+
+    // N-Queens (Backtracking.cpp)
+    TryQueen,           // Trying queen at ({0},{1})
+    PlaceQueen,         // Placed queen at ({0},{1})
+    Backtrack,          // Backtracking from ({0},{1})
+    NotSafe,            // Position ({0},{1}) is not safe
+    SolutionFound,      // Solution found!
+
+    // Shortest-path tree repair (shortest_path.h, session mode)
+    TreeCut,            // Edge {0}-{1} now weighs {2}: re-deriving {3} nodes below it
+    TreeShortcut,       // Edge {0}-{1} now weighs {2}: shorter way to node {1}
+};
+
+struct Message {
+    static constexpr int kMaxArgs = 4;
+
+    Id id;
+    uint8_t count;
+    int64_t args[kMaxArgs];
+
+    template <class... Args>
+    constexpr Message(Id id, Args... values) : id(id), count(sizeof...(Args)), args{static_cast<int64_t>(values)...} {
+        static_assert(sizeof...(Args) <= kMaxArgs, "a message takes at most four arguments");
+    }
+};
+
+} // namespace msg
@@ -1,28 +1,71 @@
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include "trace_writer.h"
+#include "tracer.h"
+#include "batch.h"
+#include "bulk_input.h"
 
 using namespace std;
 
 const int d = 256; // number of characters in the input alphabet
 const int q = 101; // prime number for hashing
-void logStep(const string& text, int l, int r, const string& message, const string& pattern) {
-    cout << "{";
-    cout << "\"type\":\"Rabin-Karp\", ";
-    if (l >= 0) cout << "\"l\":" << l << ", ";
-    if (r >= 0) cout << "\"r\":" << r << ", ";
-    cout << "\"text\":\"" << text << "\", ";
-    cout << "\"pattern\":\"" << pattern << "\", ";
-    cout << "\"message\":\"" << message << "\"";
-    cout << "}" << endl;
+string formatStep(string_view text, int l, int r, const string& message, string_view pattern) {
+    ostringstream out;
+    out << "{";
+    out << "\"type\":\"Rabin-Karp\", ";
+    if (l >= 0) out << "\"l\":" << l << ", ";
+    if (r >= 0) out << "\"r\":" << r << ", ";
+    out << "\"text\":" << jsonString(text) << ", ";
+    out << "\"pattern\":"    << jsonString(pattern) << ", ";
+    out << "\"message\":\"" << message << "\"";
+    out << "}";
+    return out.str();
 }
 
-void rabinKarpSearch(const string& text, const string& pattern) {
+void logStep(string_view text, int l, int r, const string& message, string_view pattern) {
+    trace::emit(formatStep(text, l, r, message, pattern));
+}
+
+// Streams every step to the visualizer.
+struct StreamTracer {
+    static constexpr bool enabled = true;
+
+    template <class Message>
+    void step(string_view text, int l, int r, Message&& message, string_view pattern) {
+        logStep(text, l, r, message(), pattern);
+    }
+};
+
+// Collects the steps of one batch input instead of streaming them.
+struct BufferedTracer {
+    static constexpr bool enabled = true;
+    StepBuffer& steps;
+
+    template <class Message>
+    void step(string_view text, int l, int r, Message&& message, string_view pattern) {
+        steps.add(formatStep(text, l, r, message(), pattern));
+    }
+};
+
+// Returns the index of the first match, or -1.
+template <class Tracer>
+int rabinKarpSearch(string_view text, string_view pattern, Tracer& trace) {
     int n = text.size();
     int m = pattern.size();
     int p = 0; // hash for pattern
     int t = 0; // hash for text
     int h = 1;
 
+    // The initial hash reads m characters of the text.
+    if (m > n) {
+        trace.step(text, -1, -1, [] { return "Pattern not found"; }, pattern);
+        return -1;
+    }
+
     // computing the hash function : h = (d^(m-1)) % q
     for (int i = 0; i < m - 1; i++)
         h = (h * d) % q;
@@ -34,15 +77,15 @@ void rabinKarpSearch(const string& text, const string& pattern) {
     }
 
     for (int i = 0; i <= n - m; i++) {
-        logStep(text, i, -1, "Checking substring starting at index " + to_string(i), pattern);
+        trace.step(text, i, -1, [&] { return "Checking substring starting at index " + to_string(i); }, pattern);
         if (p == t) {
             int j;
             for (j = 0; j < m; j++)
                 if (text[i + j] != pattern[j])
                     break;
             if (j == m) {
-                logStep(text, i, -1, "Pattern found at index " + to_string(i), pattern);
-                return;
+                trace.step(text, i, -1, [&] { return "Pattern found at index " + to_string(i); }, pattern);
+                return i;
             }
         }
         if (i < n - m) {
@@ -51,17 +94,79 @@ void rabinKarpSearch(const string& text, const string& pattern) {
         }
     }
 
-    logStep(text, -1, -1, "Pattern not found", pattern);
+    trace.step(text, -1, -1, [] { return "Pattern not found"; }, pattern);
+    return -1;
+}
+
+// One input per stdin line: text and pattern separated by a tab. Each frame's
+// result is the index of the first match, or -1.
+int runSearchBatch(const BatchOptions& batch) {
+    return runBatch(batch, [](const vector<string>& fields, StepBuffer* steps) {
+        if (fields.size() != 2 || fields[1].empty()) throw invalid_argument("Expected text and a non-empty pattern.");
+        int index;
+        if (steps) {
+            BufferedTracer tracer{*steps};
+            tracer.step(fields[0], -1, -1, [] { return "Starting Rabin-Karp Search"; }, fields[1]);
+            index = rabinKarpSearch(fields[0], fields[1], tracer);
+        } else {
+            NullTracer tracer;
+            index = rabinKarpSearch(fields[0], fields[1], tracer);
+        }
+        return to_string(index);
+    });
+}
+
+// --stdin-format=utf8: the pattern is the first line of stdin and the text
+// everything after it, newlines included; both are views into the input.
+bool splitStdin(const bulk::Input& input, string_view& text, string_view& pattern) {
+    string_view bytes = input.bytes();
+    size_t end = bytes.find('\n');
+    if (end == string_view::npos) return false;
+    pattern = bytes.substr(0, end);
+    text = bytes.substr(end + 1);
+    return true;
 }
 
 int main(int argc, char* argv[]) {
-    string text  = "pansinghtomar";
-    string pattern = "singh";
+    BatchOptions batch;
+    bulk::Format format = bulk::Format::None;
+    try {
+        while (argc > 1 && (parseBatchOption(argv[1], batch) || bulk::parseFormatOption(argv[1], format))) {
+            ++argv;
+            --argc;
+        }
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    if (format != bulk::Format::None && (format != bulk::Format::Utf8 || batch.enabled)) {
+        cerr << "Only --stdin-format=utf8 is supported, and not with --batch." << endl;
+        return 1;
+    }
+    if (batch.enabled) return runSearchBatch(batch);
+
+    string_view text = "pansinghtomar";
+    string_view pattern = "singh";
 
-    if (argc > 1) text    = argv[1];
-    if (argc > 2) pattern = argv[2];
+    optional<bulk::Input> input;
+    if (format == bulk::Format::Utf8) {
+        input.emplace(bulk::Input::readStdin());
+        if (!splitStdin(*input, text, pattern)) {
+            cerr << "Expected the pattern on the first line of stdin." << endl;
+            return 1;
+        }
+    } else {
+        if (argc > 1) text    = argv[1];
+        if (argc > 2) pattern = argv[2];
+    }
+    // Like the batch path, refuse an empty pattern: the searches index pattern[0].
+    if (pattern.empty()) {
+        cerr << "Expected a non-empty pattern." << endl;
+        return 1;
+    }
 
-    logStep(text, -1, -1, "Starting Rabin-Karp Search", pattern);
-    rabinKarpSearch(text, pattern);
+    SelectedTracer<StreamTracer> tracer;
+    tracer.step(text, -1, -1, [] { return "Starting Rabin-Karp Search"; }, pattern);
+    rabinKarpSearch(text, pattern, tracer);
     return 0;
 }
@@ -0,0 +1,103 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <chrono>
+#include "trace_writer.h"
+#include "tracer.h"
+#include "alignment.h"
+#include "batch.h"
+#include "dp_step.h"
+
+using namespace std;
+
+// Tables up to this many cells are filled by the traced kernel so the
+// visualizer can draw them; anything larger only reports its score.
+const long long kTracedCells = 2500;
+
+// Streams every step to the visualizer.
+struct StreamTracer {
+    static constexpr bool enabled = true;
+
+    void step(int i, int j, const char* decision, int currentValue, const vector<int>& row) {
+        trace::emit(formatDpStep(i, j, decision, currentValue, row));
+    }
+};
+
+int main(int argc, char* argv[]) {
+    // Leading options:
+    //   --kernel=<k>   auto (default), rows, diagonal, bit-parallel or tiled
+    //   --threads=<n>  threads for the tiled kernel (default and maximum: one
+    //                  per core)
+    //   --stdin        read the two sequences as two lines of stdin
+    string kernel = "auto";
+    unsigned threads = maxThreads();
+    bool fromStdin = false;
+    int first = 1;
+    for (; first < argc && string(argv[first]).rfind("--", 0) == 0; ++first) {
+        string option = argv[first];
+        if (option.rfind("--kernel=", 0) == 0) kernel = option.substr(9);
+        else if (option.rfind("--threads=", 0) == 0) {
+            try {
+                if (unsigned n = parseThreadCount(option.substr(10))) threads = n;
+            } catch (const invalid_argument& e) {
+                cerr << e.what() << endl;
+                return 1;
+            }
+        }
+        else if (option == "--stdin") fromStdin = true;
+        else {
+            cerr << "Unknown option " << option << endl;
+            return 1;
+        }
+    }
+    if (kernel != "auto" && kernel != "rows" && kernel != "diagonal" && kernel != "bit-parallel" && kernel != "tiled") {
+        cerr << "Unknown kernel " << kernel << endl;
+        return 1;
+    }
+
+    // <edit|lcs|local> <a> <b>
+    string modeName = first < argc ? argv[first] : "edit";
+    string a = "kitten", b = "sitting";
+    if (fromStdin) {
+        getline(cin, a);
+        getline(cin, b);
+    } else {
+        if (argc > first + 1) a = argv[first + 1];
+        if (argc > first + 2) b = argv[first + 2];
+    }
+
+    align::Mode mode;
+    if (modeName == "edit") mode = align::Mode::Edit;
+    else if (modeName == "lcs") mode = align::Mode::Lcs;
+    else if (modeName == "local") mode = align::Mode::Local;
+    else {
+        cerr << "Unknown alignment " << modeName << " (edit, lcs or local)" << endl;
+        return 1;
+    }
+
+    long long cells = (long long)(a.size() + 1) * (b.size() + 1);
+    if (kernel == "auto" && cells <= kTracedCells) {
+        trace::emit("{\"action\": \"start\", \"mode\": \"" + modeName + "\", \"a\": " + jsonString(a) + ", \"b\": " + jsonString(b) + "}");
+        SelectedTracer<StreamTracer> tracer;
+        long long score = align::rowsScore(a, b, align::Scoring::of(mode), tracer);
+        trace::emit("{\"finalValue\": " + to_string(score) + "}");
+        trace::emit("{\"action\": \"end\"}");
+        return 0;
+    }
+
+    auto start = chrono::steady_clock::now();
+    align::Result result = align::score(a, b, mode, kernel, threads);
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    ostringstream out;
+    out << "{";
+    out << "\"mode\": \"" << modeName << "\", ";
+    out << "\"kernel\": \"" << result.kernel << "\", ";
+    out << "\"cells\": " << cells << ", ";
+    out << "\"ms\": " << ms << ", ";
+    out << "\"finalValue\": " << result.score;
+    out << "}";
+    trace::emit(out.str());
+    return 0;
+}
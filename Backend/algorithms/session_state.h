@@ -0,0 +1,144 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "trace_writer.h"
+
+// Incremental re-runs for binaries started with --session=<file>.
+//
+// A run in session mode saves what it computed to <file>; the next run with
+// the same file loads it, works out what changed in the input, and redoes
+// only the part of the computation that depends on the change. A missing or
+// unreadable file (the first run, or a file from another algorithm) just
+// means a full run that starts the session.
+//
+// Each session run ends with a report of the work done against what a full
+// run would have done, in the binary's own unit of work:
+//
+//   {"type":"incremental", "unit":"cells", "work":120, "fullWork":4000, "saved":3880}
+//
+// State files start with a magic number naming their layout and are
+// replaced atomically, so a run that fails part way leaves the previous
+// state in place.
+namespace session {
+
+// Consumes --session=<file>; returns false if `option` is not it.
+inline bool parseSessionOption(const std::string& option, std::string& file) {
+    if (option.rfind("--session=", 0) != 0) return false;
+    file = option.substr(10);
+    return true;
+}
+
+class Writer {
+public:
+    Writer(std::string file, uint32_t magic) : file_(std::move(file)), temp_(file_ + ".tmp") {
+        f_ = std::fopen(temp_.c_str(), "wb");
+        ok_ = f_ != nullptr;
+        value(magic);
+    }
+    ~Writer() {
+        if (f_) std::fclose(f_);
+    }
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    template <class T>
+    void value(const T& v) {
+        ok_ = ok_ && std::fwrite(&v, sizeof v, 1, f_) == 1;
+    }
+
+    template <class T>
+    void array(const std::vector<T>& v) {
+        value<uint64_t>(v.size());
+        ok_ = ok_ && (v.empty() || std::fwrite(v.data(), sizeof(T), v.size(), f_) == v.size());
+    }
+
+    void text(std::string_view s) {
+        value<uint64_t>(s.size());
+        ok_ = ok_ && (s.empty() || std::fwrite(s.data(), 1, s.size(), f_) == s.size());
+    }
+
+    // Moves the new state into place; returns false (and keeps the old state)
+    // if anything failed to write.
+    bool commit() {
+        if (!f_) return false;
+        ok_ = std::fclose(f_) == 0 && ok_;
+        f_ = nullptr;
+        if (ok_ && std::rename(temp_.c_str(), file_.c_str()) == 0) return true;
+        std::remove(temp_.c_str());
+        return false;
+    }
+
+private:
+    std::string file_, temp_;
+    FILE* f_;
+    bool ok_;
+};
+
+// Reads a state file written by Writer. ok() is false if the file is missing,
+// has a different magic number, or ends early; fields read after that are
+// left empty.
+class Reader {
+public:
+    Reader(const std::string& file, uint32_t magic) {
+        f_ = std::fopen(file.c_str(), "rb");
+        ok_ = f_ != nullptr;
+        uint32_t found = 0;
+        value(found);
+        ok_ = ok_ && found == magic;
+    }
+    ~Reader() {
+        if (f_) std::fclose(f_);
+    }
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    bool ok() const { return ok_; }
+
+    template <class T>
+    void value(T& v) {
+        ok_ = ok_ && std::fread(&v, sizeof v, 1, f_) == 1;
+    }
+
+    template <class T>
+    void array(std::vector<T>& v) {
+        uint64_t size = 0;
+        value(size);
+        if (!ok_ || size > kMaxElements) {
+            ok_ = false;
+            v.clear();
+            return;
+        }
+        v.resize(size);
+        ok_ = size == 0 || std::fread(v.data(), sizeof(T), size, f_) == size;
+    }
+
+    void text(std::string& s) {
+        uint64_t size = 0;
+        value(size);
+        if (!ok_ || size > kMaxElements) {
+            ok_ = false;
+            s.clear();
+            return;
+        }
+        s.resize(size);
+        ok_ = size == 0 || std::fread(s.data(), 1, size, f_) == size;
+    }
+
+private:
+    // Guards against allocating from a corrupt size field.
+    static constexpr uint64_t kMaxElements = uint64_t(1) << 36;
+
+    FILE* f_;
+    bool ok_;
+};
+
+inline void reportWork(const char* unit, uint64_t work, uint64_t fullWork) {
+    trace::emit("{\"type\":\"incremental\", \"unit\":\"" + std::string(unit) + "\", \"work\":" + std::to_string(work) +
+                ", \"fullWork\":" + std::to_string(fullWork) +
+                ", \"saved\":" + std::to_string(fullWork > work ? fullWork - work : 0) + "}");
+}
+
+} // namespace session
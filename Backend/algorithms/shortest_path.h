@@ -0,0 +1,584 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "messages.h"
+#include "session_state.h"
+#include "tracer.h"
+
+// Point-to-point shortest paths on undirected graphs with non-negative
+// weights: Dijkstra that stops once the target is settled, bidirectional
+// Dijkstra, and A* over a precomputed landmark (ALT) index that can be saved
+// to disk and reused for any number of later queries on the same graph.
+// A full shortest-path tree can also be kept between runs and repaired after
+// edge weights change instead of being recomputed.
+//
+// Nodes keep their caller-facing ids in traces and results; internally they
+// are renumbered 0..n-1 and edges are stored in compressed sparse rows.
+//
+// Trace points use tracer.step(type, a, b, message) with the same types the
+// Greedy visualizer already understands (choose, skip, visit, consider,
+// update), plus "stop" when a search ends early and "meet" when the two
+// halves of a bidirectional search connect. Messages are msg::Message values
+// (see messages.h).
+namespace sp {
+
+constexpr int kInf = std::numeric_limits<int>::max();
+
+struct CsrGraph {
+    std::vector<int> ids;                  // dense index -> node id
+    std::unordered_map<int, int> index;    // node id -> dense index
+    std::vector<uint32_t> offsets;         // edges of u: [offsets[u], offsets[u + 1])
+    std::vector<int> targets;
+    std::vector<int> weights;
+
+    int size() const { return (int)ids.size(); }
+
+    int find(int id) const {
+        auto it = index.find(id);
+        return it == index.end() ? -1 : it->second;
+    }
+
+    // From any map of node id -> list of {to, weight} edges; every edge must
+    // already be listed from both ends. Nodes are numbered in id order so the
+    // layout does not depend on hash order.
+    template <class Adjacency>
+    static CsrGraph from(const Adjacency& adjacency) {
+        CsrGraph g;
+        for (const auto& [u, edges] : adjacency) {
+            g.ids.push_back(u);
+            for (const auto& e : edges) g.ids.push_back(e.to);
+        }
+        std::sort(g.ids.begin(), g.ids.end());
+        g.ids.erase(std::unique(g.ids.begin(), g.ids.end()), g.ids.end());
+        for (int i = 0; i < g.size(); ++i) g.index[g.ids[i]] = i;
+
+        g.offsets.assign(g.size() + 1, 0);
+        for (const auto& [u, edges] : adjacency) g.offsets[g.index[u] + 1] += edges.size();
+        for (int i = 0; i < g.size(); ++i) g.offsets[i + 1] += g.offsets[i];
+
+        g.targets.resize(g.offsets.back());
+        g.weights.resize(g.offsets.back());
+        std::vector<uint32_t> fill(g.offsets.begin(), g.offsets.end() - 1);
+        for (const auto& [u, edges] : adjacency) {
+            int du = g.index[u];
+            for (const auto& e : edges) {
+                if (e.weight < 0) throw std::invalid_argument("Negative edge weight " + std::to_string(e.weight));
+                g.targets[fill[du]] = g.index[e.to];
+                g.weights[fill[du]++] = e.weight;
+            }
+        }
+        return g;
+    }
+};
+
+// Distance and predecessor labels for one search, reusable across queries.
+// Resetting only bumps a round number, so a query that touches a few nodes
+// of a large graph does not pay to clear all of them.
+struct Labels {
+    std::vector<int> dist, prev;
+    std::vector<uint32_t> round;
+    uint32_t current = 0;
+
+    void reset(int n) {
+        if ((int)round.size() != n) {
+            dist.assign(n, kInf);
+            prev.assign(n, -1);
+            round.assign(n, 0);
+            current = 0;
+        }
+        if (++current == 0) {
+            std::fill(round.begin(), round.end(), 0);
+            current = 1;
+        }
+    }
+    int distance(int v) const { return round[v] == current ? dist[v] : kInf; }
+    int parent(int v) const { return round[v] == current ? prev[v] : -1; }
+    void set(int v, int d, int p) {
+        round[v] = current;
+        dist[v] = d;
+        prev[v] = p;
+    }
+};
+
+struct PathResult {
+    int cost = kInf;          // kInf when the target is unreachable
+    std::vector<int> path;    // node ids from source to target
+    size_t settled = 0;       // nodes settled, a measure of the work done
+};
+
+using MinQueue = std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>, std::greater<>>;
+
+inline std::vector<int> walkBack(const CsrGraph& g, const Labels& labels, int from) {
+    std::vector<int> path;
+    for (int v = from; v != -1; v = labels.parent(v)) path.push_back(g.ids[v]);
+    return path;
+}
+
+// A* from s to t; with a zero heuristic this is Dijkstra. Stops as soon as t
+// is settled. `h(v)` must be a consistent lower bound on the distance v -> t.
+template <class Heuristic, class Tracer>
+PathResult aStar(const CsrGraph& g, int s, int t, Labels& labels, Heuristic h, Tracer& trace) {
+    PathResult result;
+    labels.reset(g.size());
+    labels.set(s, 0, -1);
+    MinQueue pq;
+    pq.push({h(s), s});
+
+    while (!pq.empty()) {
+        auto [key, u] = pq.top();
+        pq.pop();
+        int d = labels.distance(u), queued = key - h(u);
+        trace.step("choose", g.ids[u], queued, msg::Message(msg::ChooseNode, g.ids[u], queued));
+        if (queued > d) {
+            trace.step("skip", g.ids[u], queued, msg::Message(msg::StaleEntry, g.ids[u]));
+            continue;
+        }
+        ++result.settled;
+        trace.step("visit", g.ids[u], d, msg::Message(msg::VisitNode, g.ids[u]));
+
+        if (u == t) {
+            trace.step("stop", g.ids[u], d, msg::Message(msg::TargetSettled, g.ids[u]));
+            result.cost = d;
+            result.path = walkBack(g, labels, t);
+            std::reverse(result.path.begin(), result.path.end());
+            return result;
+        }
+
+        for (uint32_t e = g.offsets[u]; e < g.offsets[u + 1]; ++e) {
+            int v = g.targets[e], w = g.weights[e];
+            trace.step("consider", g.ids[u], g.ids[v], msg::Message(msg::ConsiderEdge, g.ids[u], g.ids[v], w));
+            if (d + w < labels.distance(v)) {
+                labels.set(v, d + w, u);
+                pq.push({d + w + h(v), v});
+                trace.step("update", g.ids[v], d + w, msg::Message(msg::UpdateDist, g.ids[v], d + w));
+            }
+        }
+    }
+    return result;
+}
+
+template <class Tracer>
+PathResult dijkstra(const CsrGraph& g, int s, int t, Labels& labels, Tracer& trace) {
+    return aStar(g, s, t, labels, [](int) { return 0; }, trace);
+}
+
+// Bidirectional Dijkstra: grows a search from each end, always advancing the
+// side whose next node is closer, and stops once the two frontiers together
+// cannot beat the best connection found so far.
+template <class Tracer>
+PathResult bidirectionalDijkstra(const CsrGraph& g, int s, int t, Labels& forward, Labels& backward, Tracer& trace) {
+    PathResult result;
+    forward.reset(g.size());
+    backward.reset(g.size());
+    forward.set(s, 0, -1);
+    backward.set(t, 0, -1);
+    MinQueue pqF, pqB;
+    pqF.push({0, s});
+    pqB.push({0, t});
+    int best = s == t ? 0 : kInf, meet = s == t ? s : -1;
+
+    while (!pqF.empty() && !pqB.empty() && (long long)pqF.top().first + pqB.top().first < best) {
+        bool isForward = pqF.top().first <= pqB.top().first;
+        MinQueue& pq = isForward ? pqF : pqB;
+        Labels& mine = isForward ? forward : backward;
+        Labels& other = isForward ? backward : forward;
+        auto side = [&](msg::Id forwardId, msg::Id backwardId) { return isForward ? forwardId : backwardId; };
+
+        auto [d, u] = pq.top();
+        pq.pop();
+        trace.step("choose", g.ids[u], d, msg::Message(side(msg::ForwardChoose, msg::BackwardChoose), g.ids[u], d));
+        if (d > mine.distance(u)) {
+            trace.step("skip", g.ids[u], d, msg::Message(side(msg::ForwardStale, msg::BackwardStale), g.ids[u]));
+            continue;
+        }
+        ++result.settled;
+        trace.step("visit", g.ids[u], d, msg::Message(side(msg::ForwardVisit, msg::BackwardVisit), g.ids[u]));
+
+        for (uint32_t e = g.offsets[u]; e < g.offsets[u + 1]; ++e) {
+            int v = g.targets[e], w = g.weights[e];
+            trace.step("consider", g.ids[u], g.ids[v], msg::Message(side(msg::ForwardConsider, msg::BackwardConsider), g.ids[u], g.ids[v], w));
+            if (d + w < mine.distance(v)) {
+                mine.set(v, d + w, u);
+                pq.push({d + w, v});
+                trace.step("update", g.ids[v], d + w, msg::Message(side(msg::ForwardUpdate, msg::BackwardUpdate), g.ids[v], d + w));
+            }
+            int there = other.distance(v);
+            if (there != kInf && (long long)d + w + there < best) {
+                best = d + w + there;
+                meet = v;
+                trace.step("meet", g.ids[v], best, msg::Message(msg::SearchesMeet, g.ids[v], best));
+            }
+        }
+    }
+    if (meet != -1 && !pqF.empty() && !pqB.empty()) {
+        trace.step("stop", g.ids[meet], best, msg::Message(msg::FrontiersStop, best));
+    }
+
+    if (meet == -1) return result;
+    result.cost = best;
+    result.path = walkBack(g, forward, meet);
+    std::reverse(result.path.begin(), result.path.end());
+    std::vector<int> rest = walkBack(g, backward, meet);
+    result.path.insert(result.path.end(), rest.begin() + 1, rest.end());
+    return result;
+}
+
+// ALT index: exact distances from a few well-spread landmarks to every node.
+// By the triangle inequality |d(L, t) - d(L, v)| <= d(v, t) for every
+// landmark L, which gives A* a lower bound far tighter than zero, so a query
+// settles a narrow corridor of nodes instead of a ball around the source.
+class AltIndex {
+public:
+    CsrGraph graph;
+    std::vector<int> landmarks;   // dense node indices
+    std::vector<int> dist;        // dist[v * landmarks.size() + l]
+
+    // Picks `count` landmarks by farthest-point selection: each new landmark
+    // is the node farthest from those already chosen. Needs count >= 1.
+    static AltIndex build(CsrGraph g, int count) {
+        if (count < 1) throw std::invalid_argument("An ALT index needs at least one landmark");
+        AltIndex alt;
+        alt.graph = std::move(g);
+        int n = alt.graph.size();
+        count = std::min(count, n);
+        std::vector<int> nearest(n, kInf);
+        Labels labels;
+        std::vector<std::vector<int>> columns;
+
+        int next = n ? farthestFrom(alt.graph, 0, labels) : -1;
+        while ((int)alt.landmarks.size() < count && next != -1) {
+            alt.landmarks.push_back(next);
+            columns.push_back(allDistances(alt.graph, next, labels));
+            // Nodes no landmark reaches (another component) come first.
+            next = 0;
+            for (int v = 0; v < n; ++v) {
+                nearest[v] = std::min(nearest[v], columns.back()[v]);
+                if (nearest[v] > nearest[next]) next = v;
+            }
+            if (nearest[next] == 0) break;  // every node is a landmark
+        }
+
+        size_t k = alt.landmarks.size();
+        alt.dist.resize(n * k);
+        for (int v = 0; v < n; ++v)
+            for (size_t l = 0; l < k; ++l) alt.dist[v * k + l] = columns[l][v];
+        return alt;
+    }
+
+    // Lower bound on the distance from v to t.
+    int lowerBound(int v, int t) const {
+        size_t k = landmarks.size();
+        const int* dv = &dist[v * k];
+        const int* dt = &dist[t * k];
+        int bound = 0;
+        for (size_t l = 0; l < k; ++l) {
+            if (dv[l] == kInf || dt[l] == kInf) continue;
+            bound = std::max(bound, std::abs(dt[l] - dv[l]));
+        }
+        return bound;
+    }
+
+    template <class Tracer>
+    PathResult query(int s, int t, Labels& labels, Tracer& trace) const {
+        return aStar(graph, s, t, labels, [&](int v) { return lowerBound(v, t); }, trace);
+    }
+
+    // Writes to file + ".tmp" and renames it into place, so a failed or
+    // interrupted build never leaves a partial index under `file`.
+    void save(const std::string& file) const {
+        std::string temp = file + ".tmp";
+        FILE* f = std::fopen(temp.c_str(), "wb");
+        if (!f) throw std::runtime_error("Cannot write " + file);
+        uint32_t header[4] = {kMagic, (uint32_t)graph.size(), (uint32_t)graph.targets.size(), (uint32_t)landmarks.size()};
+        bool ok = std::fwrite(header, sizeof header, 1, f) == 1 &&
+                  writeAll(f, graph.ids) && writeAll(f, graph.offsets) && writeAll(f, graph.targets) &&
+                  writeAll(f, graph.weights) && writeAll(f, landmarks) && writeAll(f, dist);
+        ok = std::fclose(f) == 0 && ok;
+        if (!ok || std::rename(temp.c_str(), file.c_str()) != 0) {
+            std::remove(temp.c_str());
+            throw std::runtime_error("Failed writing " + file);
+        }
+    }
+
+    static AltIndex load(const std::string& file) {
+        FILE* f = std::fopen(file.c_str(), "rb");
+        if (!f) throw std::runtime_error("Cannot read " + file);
+        AltIndex alt;
+        uint32_t header[4];
+        bool ok = std::fread(header, sizeof header, 1, f) == 1 && header[0] == kMagic;
+        size_t n = ok ? header[1] : 0, m = ok ? header[2] : 0, k = ok ? header[3] : 0;
+        // The header must account for exactly the rest of the file before
+        // anything is allocated from it.
+        uint64_t expected = sizeof header + 4 * ((uint64_t)n + (n + 1) + 2 * (uint64_t)m + k + (uint64_t)n * k);
+        ok = ok && n <= (size_t)kInf && k <= n && (k > 0 || n == 0) && std::fseek(f, 0, SEEK_END) == 0 &&
+             (uint64_t)std::ftell(f) == expected && std::fseek(f, sizeof header, SEEK_SET) == 0;
+        ok = ok && readAll(f, alt.graph.ids, n) && readAll(f, alt.graph.offsets, n + 1) &&
+             readAll(f, alt.graph.targets, m) && readAll(f, alt.graph.weights, m) &&
+             readAll(f, alt.landmarks, k) && readAll(f, alt.dist, n * k);
+        std::fclose(f);
+        ok = ok && alt.valid();
+        if (!ok) throw std::runtime_error(file + " is not a landmark index");
+        for (int i = 0; i < alt.graph.size(); ++i) alt.graph.index[alt.graph.ids[i]] = i;
+        return alt;
+    }
+
+private:
+    static constexpr uint32_t kMagic = 0x31544c41;  // "ALT1"
+
+    // Whether every stored index is in range (offsets rise from 0 to the
+    // edge count, and targets and landmarks are nodes) and no weight or
+    // distance is negative, which lowerBound's differences rely on.
+    bool valid() const {
+        size_t n = graph.ids.size(), m = graph.targets.size();
+        if (graph.offsets.empty() || graph.offsets.front() != 0 || graph.offsets.back() != m) return false;
+        for (size_t v = 0; v < n; ++v)
+            if (graph.offsets[v] > graph.offsets[v + 1]) return false;
+        auto isNode = [n](int v) { return v >= 0 && (size_t)v < n; };
+        return std::all_of(graph.targets.begin(), graph.targets.end(), isNode) &&
+               std::all_of(landmarks.begin(), landmarks.end(), isNode) &&
+               std::all_of(graph.weights.begin(), graph.weights.end(), [](int w) { return w >= 0; }) &&
+               std::all_of(dist.begin(), dist.end(), [](int d) { return d >= 0; });
+    }
+
+    static std::vector<int> allDistances(const CsrGraph& g, int s, Labels& labels) {
+        NullTracer none;
+        dijkstra(g, s, -1, labels, none);
+        std::vector<int> d(g.size());
+        for (int v = 0; v < g.size(); ++v) d[v] = labels.distance(v);
+        return d;
+    }
+
+    static int farthestFrom(const CsrGraph& g, int s, Labels& labels) {
+        std::vector<int> d = allDistances(g, s, labels);
+        int far = s;
+        for (int v = 0; v < g.size(); ++v)
+            if (d[v] != kInf && d[v] > d[far]) far = v;
+        return far;
+    }
+
+    template <class T>
+    static bool writeAll(FILE* f, const std::vector<T>& v) {
+        return v.empty() || std::fwrite(v.data(), sizeof(T), v.size(), f) == v.size();
+    }
+
+    template <class T>
+    static bool readAll(FILE* f, std::vector<T>& v, size_t count) {
+        v.resize(count);
+        return count == 0 || std::fread(v.data(), sizeof(T), count, f) == count;
+    }
+};
+
+// Shortest-path tree from one source to every node, for session mode: after
+// an edit only the nodes whose distance can change are searched again.
+//
+// An edge that got lighter can only shorten paths through it, so its far
+// end is re-queued with the better distance. An edge that got heavier (or
+// was removed) only matters if the tree uses it; the subtree below it loses
+// its distances and each of its nodes is re-seeded from its neighbours
+// outside the subtree. One Dijkstra pass from all the re-queued nodes then
+// settles exactly the nodes whose distance or parent changes.
+struct EdgeChange {
+    int u, v;           // dense indices
+    int before, after;  // lightest weight between u and v; kInf if none
+};
+
+class PathTree {
+public:
+    CsrGraph graph;
+    int source = -1;
+    std::vector<int> dist, parent;
+
+    template <class Tracer>
+    static PathTree build(CsrGraph g, int s, Tracer& trace, size_t& settled) {
+        PathTree tree;
+        tree.graph = std::move(g);
+        tree.source = s;
+        Labels labels;
+        settled = dijkstra(tree.graph, s, -1, labels, trace).settled;
+        tree.dist.resize(tree.graph.size());
+        tree.parent.resize(tree.graph.size());
+        for (int v = 0; v < tree.graph.size(); ++v) {
+            tree.dist[v] = labels.distance(v);
+            tree.parent[v] = labels.parent(v);
+        }
+        return tree;
+    }
+
+    // Edges whose weight differs between two graphs over the same nodes.
+    static std::vector<EdgeChange> diff(const CsrGraph& before, const CsrGraph& after) {
+        std::vector<EdgeChange> changes;
+        std::vector<std::pair<int, int>> a, b;
+        for (int u = 0; u < after.size(); ++u) {
+            lightest(before, u, a);
+            lightest(after, u, b);
+            size_t i = 0, j = 0;
+            while (i < a.size() || j < b.size()) {
+                int v = j == b.size() || (i < a.size() && a[i].first < b[j].first) ? a[i].first : b[j].first;
+                int wa = i < a.size() && a[i].first == v ? a[i++].second : kInf;
+                int wb = j < b.size() && b[j].first == v ? b[j++].second : kInf;
+                if (u < v && wa != wb) changes.push_back({u, v, wa, wb});
+            }
+        }
+        return changes;
+    }
+
+    // Brings the tree up to date with `g`, which has the same nodes as the
+    // tree's graph. Returns the number of nodes settled.
+    template <class Tracer>
+    size_t repair(CsrGraph g, const std::vector<EdgeChange>& changes, Tracer& trace) {
+        graph = std::move(g);
+        int n = graph.size();
+        MinQueue pq;
+        size_t settled = 0;
+
+        std::vector<int> cut;
+        for (const EdgeChange& c : changes) {
+            if (c.after <= c.before) continue;
+            int child = usesEdge(c.u, c.v, c.before) ? c.v : usesEdge(c.v, c.u, c.before) ? c.u : -1;
+            if (child == -1) continue;
+            size_t first = cut.size();
+            collectSubtree(child, cut);
+            trace.step("update", graph.ids[child], c.after,
+                       msg::Message(msg::TreeCut, graph.ids[c.u], graph.ids[c.v], c.after, cut.size() - first));
+        }
+        std::vector<char> isCut(n, 0);
+        for (int v : cut) {
+            isCut[v] = 1;
+            dist[v] = kInf;
+            parent[v] = -1;
+        }
+        for (int v : cut) {
+            for (uint32_t e = graph.offsets[v]; e < graph.offsets[v + 1]; ++e) {
+                int u = graph.targets[e];
+                if (isCut[u] || dist[u] == kInf || dist[u] + graph.weights[e] >= dist[v]) continue;
+                dist[v] = dist[u] + graph.weights[e];
+                parent[v] = u;
+            }
+            if (dist[v] != kInf) pq.push({dist[v], v});
+        }
+
+        for (const EdgeChange& c : changes) {
+            if (c.after >= c.before) continue;
+            for (auto [u, v] : {std::pair{c.u, c.v}, std::pair{c.v, c.u}}) {
+                if (dist[u] == kInf || dist[u] + c.after >= dist[v]) continue;
+                dist[v] = dist[u] + c.after;
+                parent[v] = u;
+                pq.push({dist[v], v});
+                trace.step("update", graph.ids[v], dist[v],
+                           msg::Message(msg::TreeShortcut, graph.ids[u], graph.ids[v], c.after));
+            }
+        }
+
+        while (!pq.empty()) {
+            auto [d, u] = pq.top();
+            pq.pop();
+            trace.step("choose", graph.ids[u], d, msg::Message(msg::ChooseNode, graph.ids[u], d));
+            if (d > dist[u]) {
+                trace.step("skip", graph.ids[u], d, msg::Message(msg::StaleEntry, graph.ids[u]));
+                continue;
+            }
+            ++settled;
+            trace.step("visit", graph.ids[u], d, msg::Message(msg::VisitNode, graph.ids[u]));
+            for (uint32_t e = graph.offsets[u]; e < graph.offsets[u + 1]; ++e) {
+                int v = graph.targets[e], w = graph.weights[e];
+                trace.step("consider", graph.ids[u], graph.ids[v], msg::Message(msg::ConsiderEdge, graph.ids[u], graph.ids[v], w));
+                if (d + w >= dist[v]) continue;
+                dist[v] = d + w;
+                parent[v] = u;
+                pq.push({dist[v], v});
+                trace.step("update", graph.ids[v], d + w, msg::Message(msg::UpdateDist, graph.ids[v], d + w));
+            }
+        }
+        return settled;
+    }
+
+    // Nodes a full run from the source settles.
+    size_t reachable() const {
+        return std::count_if(dist.begin(), dist.end(), [](int d) { return d != kInf; });
+    }
+
+    PathResult path(int t) const {
+        PathResult result;
+        if (dist[t] == kInf) return result;
+        result.cost = dist[t];
+        for (int v = t; v != -1; v = parent[v]) result.path.push_back(graph.ids[v]);
+        std::reverse(result.path.begin(), result.path.end());
+        return result;
+    }
+
+    // Returns false (keeping any previous state) if the file could not be written.
+    bool save(const std::string& file) const {
+        session::Writer out(file, kMagic);
+        out.array(graph.ids);
+        out.array(graph.offsets);
+        out.array(graph.targets);
+        out.array(graph.weights);
+        out.value(source);
+        out.array(dist);
+        out.array(parent);
+        return out.commit();
+    }
+
+    // Returns false if `file` holds no tree (the session's first run).
+    static bool load(const std::string& file, PathTree& tree) {
+        session::Reader in(file, kMagic);
+        in.array(tree.graph.ids);
+        in.array(tree.graph.offsets);
+        in.array(tree.graph.targets);
+        in.array(tree.graph.weights);
+        in.value(tree.source);
+        in.array(tree.dist);
+        in.array(tree.parent);
+        size_t n = tree.graph.ids.size();
+        if (!in.ok() || tree.graph.offsets.size() != n + 1 || tree.dist.size() != n || tree.parent.size() != n) return false;
+        for (size_t i = 0; i < n; ++i) tree.graph.index[tree.graph.ids[i]] = i;
+        return true;
+    }
+
+private:
+    static constexpr uint32_t kMagic = 0x31545053;  // "SPT1"
+
+    // Neighbours of u with the lightest weight to each, sorted by neighbour.
+    static void lightest(const CsrGraph& g, int u, std::vector<std::pair<int, int>>& out) {
+        out.clear();
+        for (uint32_t e = g.offsets[u]; e < g.offsets[u + 1]; ++e) out.emplace_back(g.targets[e], g.weights[e]);
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end(), [](auto& x, auto& y) { return x.first == y.first; }), out.end());
+    }
+
+    bool usesEdge(int from, int to, int weight) const {
+        return parent[to] == from && dist[from] != kInf && dist[to] == dist[from] + weight;
+    }
+
+    // Appends v and every node whose tree path runs through v.
+    void collectSubtree(int v, std::vector<int>& out) {
+        if (children.empty()) {
+            children.assign(graph.size(), {});
+            for (int u = 0; u < graph.size(); ++u)
+                if (parent[u] != -1) children[parent[u]].push_back(u);
+        }
+        std::vector<int> stack = {v};
+        while (!stack.empty()) {
+            int u = stack.back();
+            stack.pop_back();
+            if (dist[u] == kInf) continue;  // already cut
+            out.push_back(u);
+            dist[u] = kInf;
+            stack.insert(stack.end(), children[u].begin(), children[u].end());
+        }
+    }
+
+    std::vector<std::vector<int>> children;
+};
+
+} // namespace sp
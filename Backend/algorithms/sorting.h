@@ -0,0 +1,294 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "generator.h"
+#include "messages.h"
+#include "string_sort.h"
+#include "tracer.h"
+
+// Sorting algorithms behind SortingAlgorithm.cpp, templated on the element
+// type and on a Tracer (see tracer.h). Each trace point reports the array
+// being shown (the whole array or a span of it), a message (see messages.h),
+// the recursion depth/position used to lay out the call tree, an action tag,
+// and the highlighted indices.
+//
+// The comparison sorts take any ordered type (int, int64_t, double,
+// std::string, ...); counting and radix sort need integer keys. Strings have
+// their own sorts in string_sort.h, and sortRecords() at the bottom sorts
+// records by key without moving the records more than once.
+
+template <class T, class Tracer>
+void quickSort(std::vector<T>& arr, int low, int high, int depth, int position, Tracer& trace) {
+    if (low >= high) {
+        if (low == high) {
+            trace.step(arr, msg::Message(msg::SingleElement), depth, position, "base");
+        }
+        return;
+    }
+
+    T pivot = arr[high];
+    int i = low - 1;
+
+    trace.step(arr, msg::Message(msg::SelectPivot, high), depth, position, "pivot", high);
+
+    for (int j = low; j < high; ++j) {
+        if (arr[j] <= pivot) {
+            ++i;
+            if (i != j) {
+                std::swap(arr[i], arr[j]);
+                trace.step(arr, msg::Message(msg::Swap, i, j), depth, position, "swap", high, i, j);
+            }
+        }
+    }
+
+    std::swap(arr[i + 1], arr[high]);
+    trace.step(arr, msg::Message(msg::PlacePivot), depth, position, "pivot-swap", i + 1, high);
+
+    int pivotIndex = i + 1;
+    quickSort(arr, low, pivotIndex - 1, depth + 1, position * 2, trace);
+    quickSort(arr, pivotIndex + 1, high, depth + 1, position * 2 + 1, trace);
+}
+
+template <class T, class Tracer>
+void merge(std::vector<T>& arr, int left, int mid, int right, int depth, int position, Tracer& trace) {
+    std::vector<T> leftArr(std::make_move_iterator(arr.begin() + left), std::make_move_iterator(arr.begin() + mid + 1));
+    std::vector<T> rightArr(std::make_move_iterator(arr.begin() + mid + 1), std::make_move_iterator(arr.begin() + right + 1));
+
+    int i = 0, j = 0, k = left;
+
+    while (i < (int)leftArr.size() && j < (int)rightArr.size()) {
+        if (leftArr[i] <= rightArr[j]) arr[k++] = std::move(leftArr[i++]);
+        else arr[k++] = std::move(rightArr[j++]);
+    }
+
+    while (i < (int)leftArr.size()) arr[k++] = std::move(leftArr[i++]);
+    while (j < (int)rightArr.size()) arr[k++] = std::move(rightArr[j++]);
+
+    trace.step(std::span<const T>(arr).subspan(left, right - left + 1), msg::Message(msg::Merged, left, right),
+               depth, position, "merge");
+}
+
+template <class T, class Tracer>
+void mergeSort(std::vector<T>& arr, int left, int right, int depth, int position, Tracer& trace) {
+    if (left == right) {
+        trace.step(std::span<const T>(arr).subspan(left, 1), msg::Message(msg::CannotSplit), depth, position, "base");
+        return;
+    }
+
+    int mid = left + (right - left) / 2;
+
+    trace.step(std::span<const T>(arr).subspan(left, right - left + 1), msg::Message(msg::Splitting), depth, position, "split");
+
+    mergeSort(arr, left, mid, depth + 1, position * 2, trace);
+    mergeSort(arr, mid + 1, right, depth + 1, position * 2 + 1, trace);
+    merge(arr, left, mid, right, depth, position, trace);
+}
+
+// One step of a sort that runs as a coroutine; the array itself is read when
+// the step is printed, while the coroutine is suspended at the yield.
+struct SortStep {
+    msg::Message message;
+    int depth;
+    int position;
+    const char* action;
+    int pivotIndex;
+    int swapA;
+    int swapB;
+
+    // A real constructor rather than aggregate init: GCC 12 double-destroys
+    // aggregate temporaries passed to co_yield.
+    SortStep(msg::Message message, int depth, int position, const char* action, int pivotIndex = -1, int swapA = -1, int swapB = -1)
+        : message(message), depth(depth), position(position), action(action),
+          pivotIndex(pivotIndex), swapA(swapA), swapB(swapB) {}
+};
+
+// Bubble sort as a coroutine, so that --step runs can pull its steps one at
+// a time; bubbleSort below drains it into a tracer for everything else.
+// Without `yieldSteps` it yields nothing and sorts in a single resume, which
+// keeps untraced runs free of a suspension per step.
+template <class T>
+Generator<SortStep> bubbleSortSteps(std::vector<T>& arr, bool yieldSteps = true) {
+    int n = arr.size();
+    for (int i = 0; i < n - 1; ++i) {
+        for (int j = 0; j < n - i - 1; ++j) {
+            if (yieldSteps) co_yield SortStep(msg::Message(msg::Compare, j, j + 1), 1, i * n + j, "compare", -1, j, j + 1);
+
+            if (arr[j] > arr[j + 1]) {
+                std::swap(arr[j], arr[j + 1]);
+                if (yieldSteps) co_yield SortStep(msg::Message(msg::Swap, j, j + 1), 1, i * n + j, "swap", -1, j, j + 1);
+            } else {
+                if (yieldSteps) co_yield SortStep(msg::Message(msg::NoSwap), 1, i * n + j, "no-swap", -1, j, j + 1);
+            }
+        }
+    }
+}
+
+template <class T, class Tracer>
+void bubbleSort(std::vector<T>& arr, Tracer& trace) {
+    for (const SortStep& step : bubbleSortSteps(arr, Tracer::enabled)) {
+        trace.step(arr, step.message, step.depth, step.position, step.action, step.pivotIndex, step.swapA, step.swapB);
+    }
+}
+
+template <class T, class Tracer>
+void selectionSort(std::vector<T>& arr, Tracer& trace) {
+    int n = arr.size();
+    for (int i = 0; i < n - 1; ++i) {
+        int minIdx = i;
+        for (int j = i + 1; j < n; ++j) {
+            trace.step(arr, msg::Message(msg::CompareMin, j, minIdx), 1, 0, "compare", -1, j, minIdx);
+            if (arr[j] < arr[minIdx]) {
+                minIdx = j;
+            }
+        }
+        if (minIdx != i) {
+            std::swap(arr[i], arr[minIdx]);
+            trace.step(arr, msg::Message(msg::Swap, i, minIdx), 1, 0, "swap", -1, i, minIdx);
+        }
+    }
+}
+
+template <class T, class Tracer>
+void insertionSort(std::vector<T>& arr, Tracer& trace) {
+    int n = arr.size();
+    for (int i = 1; i < n; ++i) {
+        T key = arr[i];
+        int j = i - 1;
+
+        while (j >= 0 && arr[j] > key) {
+            arr[j + 1] = arr[j];
+            trace.step(arr, msg::Message(msg::Shift, j), 1, i, "shift", -1, j, j + 1);
+            j--;
+        }
+        arr[j + 1] = key;
+        trace.step(arr, msg::Message(msg::Insert, j + 1), 1, i, "insert", -1);
+    }
+}
+
+// Counting sort allocates one counter per key value up to the largest, so it
+// takes keys in [0, kMaxCountingKey]; radix sort takes any non-negative key.
+// sortWith() in SortingAlgorithm.cpp checks both before sorting.
+constexpr int64_t kMaxCountingKey = (1 << 24) - 1;
+
+template <class T, class Tracer>
+void countingSort(std::vector<T>& arr, int depth, int position, Tracer& trace) {
+    static_assert(std::is_integral_v<T>, "countingSort needs integer keys");
+    T maxVal = *std::max_element(arr.begin(), arr.end());
+    std::vector<int> count(maxVal + 1, 0);
+    std::vector<T> output(arr.size());
+
+    for (int i = 0; i < (int)arr.size(); i++) {
+        count[arr[i]]++;
+        trace.step(arr, msg::Message(msg::Count, i), depth, position, "count", -1, arr[i], -1);
+    }
+
+    for (T i = 1; i <= maxVal; i++) {
+        count[i] += count[i - 1];
+        trace.step(arr, msg::Message(msg::PrefixSum, i), depth, position, "prefix", -1, i, -1);
+    }
+
+    for (int i = arr.size() - 1; i >= 0; i--) {
+        output[count[arr[i]] - 1] = arr[i];
+        count[arr[i]]--;
+        trace.step(output, msg::Message(msg::Place, arr[i]), depth, position, "place", -1, count[arr[i]], i);
+    }
+
+    arr = output;
+}
+
+template <class T>
+int getDigit(T num, T exp) {
+    return (num / exp) % 10;
+}
+
+template <class T, class Tracer>
+void radixSort(std::vector<T>& arr, int depth, int position, Tracer& trace) {
+    static_assert(std::is_integral_v<T>, "radixSort needs integer keys");
+    T maxVal = *std::max_element(arr.begin(), arr.end());
+    T exp = 1;
+
+    while (maxVal / exp > 0) {
+        std::vector<T> output(arr.size());
+        std::vector<int> count(10, 0);
+
+        for (int i = 0; i < (int)arr.size(); i++) {
+            int digit = getDigit(arr[i], exp);
+            count[digit]++;
+            trace.step(arr, msg::Message(msg::Digit, i, digit, exp), depth, position, "digit", -1, digit, i);
+        }
+
+        for (int i = 1; i < 10; i++) {
+            count[i] += count[i - 1];
+            trace.step(arr, msg::Message(msg::DigitPrefixSum, i), depth, position, "prefix", -1, i, -1);
+        }
+
+        for (int i = arr.size() - 1; i >= 0; i--) {
+            int digit = getDigit(arr[i], exp);
+            output[count[digit] - 1] = arr[i];
+            count[digit]--;
+            trace.step(output, msg::Message(msg::PlaceByDigit, arr[i], digit), depth, position, "place", -1, count[digit], i);
+        }
+
+        arr = output;
+        if (exp > maxVal / 10) break;  // the next digit would be past maxVal (and exp could overflow)
+        exp *= 10;
+    }
+}
+
+// Moves records into the order given by `order` (order[k] is the index of the
+// record that belongs at position k), following each permutation cycle so
+// every record is moved exactly once and none is copied.
+template <class Record>
+void applyPermutation(std::vector<Record>& records, const std::vector<uint32_t>& order) {
+    std::vector<bool> placed(records.size(), false);
+    for (size_t start = 0; start < records.size(); ++start) {
+        if (placed[start] || order[start] == start) continue;
+        Record held = std::move(records[start]);
+        size_t cur = start;
+        for (;;) {
+            placed[cur] = true;
+            size_t src = order[cur];
+            if (src == start) {
+                records[cur] = std::move(held);
+                break;
+            }
+            records[cur] = std::move(records[src]);
+            cur = src;
+        }
+    }
+}
+
+// Sorts records by keyOf(record), stably. Only the keys (or, for string keys,
+// views of them) and record indices are sorted; the records themselves are
+// moved into place once at the end, so large payloads cost one move each
+// regardless of the algorithm. String keys go through MSD radix sort,
+// everything else through std::stable_sort.
+template <class Record, class KeyOf>
+void sortRecords(std::vector<Record>& records, KeyOf keyOf) {
+    using Key = std::decay_t<std::invoke_result_t<KeyOf, const Record&>>;
+    std::vector<uint32_t> order(records.size());
+
+    if constexpr (std::is_convertible_v<const Key&, std::string_view>) {
+        static_assert(std::is_reference_v<std::invoke_result_t<KeyOf, const Record&>>,
+                      "string keys must be returned by reference so they can be viewed in place");
+        std::vector<strsort::KeyedIndex> keyed(records.size());
+        for (uint32_t i = 0; i < records.size(); ++i) keyed[i] = {std::string_view(keyOf(records[i])), i};
+        NullTracer none;
+        strsort::msdRadixSort(keyed, none);
+        for (size_t k = 0; k < keyed.size(); ++k) order[k] = keyed[k].index;
+    } else {
+        std::vector<std::pair<Key, uint32_t>> keyed(records.size());
+        for (uint32_t i = 0; i < records.size(); ++i) keyed[i] = {keyOf(records[i]), i};
+        std::stable_sort(keyed.begin(), keyed.end(),
+                         [](const auto& a, const auto& b) { return a.first < b.first; });
+        for (size_t k = 0; k < keyed.size(); ++k) order[k] = keyed[k].second;
+    }
+
+    applyPermutation(records, order);
+}
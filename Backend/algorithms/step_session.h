@@ -0,0 +1,28 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include "generator.h"
+
+// Pull-driven stepping for binaries started with --step.
+//
+// Instead of running to completion, the binary waits on stdin for commands of
+// the form "next <count>" and advances its step generator by at most <count>
+// steps per command. Closing stdin ends the session; the remaining steps are
+// never computed.
+//
+// Returns true once the generator is exhausted, false if the session ended
+// first, so callers only report a final result for a finished run.
+template <class Step, class Emit>
+bool serveSteps(Generator<Step>& steps, Emit emit) {
+    auto it = steps.begin();
+    std::string command;
+    long count = 0;
+
+    while (it != steps.end() && std::cin >> command >> count) {
+        if (command != "next") continue;
+        for (; count > 0 && it != steps.end(); --count, ++it) {
+            emit(*it);
+        }
+    }
+    return it == steps.end();
+}
@@ -0,0 +1,238 @@
+#pragma once
+#include <algorithm>
+#include <iterator>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "messages.h"
+#include "tracer.h"
+
+// String-specialised sorts: MSD radix sort, multikey quicksort and LCP-aware
+// merge sort. Each one looks at every character of a key at most a few times
+// instead of re-comparing shared prefixes the way a comparison sort does,
+// which is where std::sort loses on log lines, URLs and other keys with long
+// common prefixes.
+//
+// Elements are only ever swapped or moved, never copied. They can be
+// std::string, std::string_view, or any type with a keyView() overload
+// returning the string to sort by (see KeyedIndex below), which is how
+// sortRecords() in sorting.h sorts a key plus payload.
+//
+// Trace points are coarse (one per partition, bucket pass or merge) and use
+// the same Tracer interface as sorting.h.
+namespace strsort {
+
+inline std::string_view keyView(const std::string& s) { return s; }
+inline std::string_view keyView(std::string_view s) { return s; }
+
+// A string key borrowed from a record, plus the record's index.
+struct KeyedIndex {
+    std::string_view key;
+    uint32_t index;
+};
+inline std::string_view keyView(const KeyedIndex& k) { return k.key; }
+
+// Trace position of child `r` of the call at `position`, numbering each level
+// of a call tree with `fanout` children per call the way the binary sorts do.
+// Radix recursion widens the tree by 256 per level, so positions that no
+// longer fit in an int are reported as -1, as are all their descendants.
+inline int childPosition(int position, int fanout, int r) {
+    if (position < 0) return -1;
+    int64_t child = (int64_t)position * fanout + r;
+    return child > INT32_MAX ? -1 : (int)child;
+}
+
+// Character d of s, or -1 past the end so that shorter strings sort first.
+inline int charAt(std::string_view s, size_t d) {
+    return d < s.size() ? static_cast<unsigned char>(s[d]) : -1;
+}
+
+// Length of the common prefix of a and b, given that the first `from`
+// characters are already known to match.
+inline size_t lcpFrom(std::string_view a, std::string_view b, size_t from) {
+    size_t n = std::min(a.size(), b.size());
+    while (from < n && a[from] == b[from]) ++from;
+    return from;
+}
+
+// Below this many strings the bookkeeping of the radix-style sorts costs more
+// than it saves.
+constexpr size_t kInsertionCutoff = 16;
+
+// Insertion sort of [lo, hi) for strings already known to share their first
+// d characters.
+template <class Str>
+void insertionSortFrom(std::vector<Str>& a, size_t lo, size_t hi, size_t d) {
+    for (size_t i = lo + 1; i < hi; ++i) {
+        for (size_t j = i; j > lo && keyView(a[j]).substr(d) < keyView(a[j - 1]).substr(d); --j) {
+            std::swap(a[j], a[j - 1]);
+        }
+    }
+}
+
+template <class Str, class Tracer>
+void msdRadixSort(std::vector<Str>& a, size_t lo, size_t hi, size_t d, std::vector<Str>& aux,
+                  std::vector<int16_t>& chars, int depth, int position, Tracer& trace) {
+    if (hi - lo <= kInsertionCutoff) {
+        insertionSortFrom(a, lo, hi, d);
+        trace.step(a, msg::Message(msg::InsertionSorted, hi - lo, d), depth, position, "base", -1, (int)lo, (int)hi - 1);
+        return;
+    }
+
+    // count[c + 1] ends up as the start of the bucket for character c, with
+    // the end-of-string bucket (c = -1) first. Each string's character is read
+    // once into `chars`; a position where every string has the same character
+    // (a shared prefix) is skipped without moving anything.
+    size_t count[258];
+    for (;;) {
+        std::fill(std::begin(count), std::end(count), 0);
+        for (size_t i = lo; i < hi; ++i) {
+            chars[i] = (int16_t)charAt(keyView(a[i]), d);
+            count[chars[i] + 2]++;
+        }
+        int only = chars[lo];
+        if (count[only + 2] != hi - lo) break;
+        if (only < 0) return; // all strings are equal
+        ++d;
+    }
+
+    for (int r = 0; r < 257; ++r) count[r + 1] += count[r];
+    for (size_t i = lo; i < hi; ++i) aux[count[chars[i] + 1]++] = std::move(a[i]);
+    for (size_t i = lo; i < hi; ++i) a[i] = std::move(aux[i - lo]);
+
+    trace.step(a, msg::Message(msg::Distributed, hi - lo, d), depth, position, "distribute", -1, (int)lo, (int)hi - 1);
+
+    // Strings that ended at d are in their final place; recurse per character.
+    for (int r = 0; r < 256; ++r) {
+        size_t bucketLo = lo + count[r], bucketHi = lo + count[r + 1];
+        if (bucketHi - bucketLo > 1) {
+            msdRadixSort(a, bucketLo, bucketHi, d + 1, aux, chars, depth + 1, childPosition(position, 256, r), trace);
+        }
+    }
+}
+
+template <class Str, class Tracer>
+void msdRadixSort(std::vector<Str>& a, Tracer& trace) {
+    std::vector<Str> aux(a.size());
+    std::vector<int16_t> chars(a.size());
+    msdRadixSort(a, 0, a.size(), 0, aux, chars, 1, 0, trace);
+}
+
+// Bentley-Sedgewick three-way radix quicksort on [lo, hi].
+template <class Str, class Tracer>
+void multikeyQuicksort(std::vector<Str>& a, long lo, long hi, size_t d, int depth, int position, Tracer& trace) {
+    if (hi - lo + 1 <= (long)kInsertionCutoff) {
+        if (hi > lo) {
+            insertionSortFrom(a, lo, hi + 1, d);
+            trace.step(a, msg::Message(msg::InsertionSorted, hi - lo + 1, d), depth, position, "base", -1, (int)lo, (int)hi);
+        }
+        return;
+    }
+
+    // Median-of-three pivot character, moved to a[lo].
+    long mid = lo + (hi - lo) / 2;
+    int x = charAt(keyView(a[lo]), d), y = charAt(keyView(a[mid]), d), z = charAt(keyView(a[hi]), d);
+    long m = (x < y) ? ((y < z) ? mid : (x < z ? hi : lo)) : ((x < z) ? lo : (y < z ? hi : mid));
+    std::swap(a[lo], a[m]);
+
+    int v = charAt(keyView(a[lo]), d);
+    long lt = lo, gt = hi, i = lo + 1;
+    while (i <= gt) {
+        int t = charAt(keyView(a[i]), d);
+        if (t < v) std::swap(a[lt++], a[i++]);
+        else if (t > v) std::swap(a[i], a[gt--]);
+        else ++i;
+    }
+
+    trace.step(a, msg::Message(msg::Partitioned, d, v), depth, position, "partition", (int)lt, (int)lo, (int)hi);
+
+    multikeyQuicksort(a, lo, lt - 1, d, depth + 1, childPosition(position, 3, 0), trace);
+    if (v >= 0) multikeyQuicksort(a, lt, gt, d + 1, depth + 1, childPosition(position, 3, 1), trace);
+    multikeyQuicksort(a, gt + 1, hi, d, depth + 1, childPosition(position, 3, 2), trace);
+}
+
+template <class Str, class Tracer>
+void multikeyQuicksort(std::vector<Str>& a, Tracer& trace) {
+    multikeyQuicksort(a, 0, (long)a.size() - 1, 0, 1, 0, trace);
+}
+
+// LCP-aware merge sort. Alongside the strings it keeps lcp[i], the length of
+// the common prefix of a[i] and a[i - 1] within the current run; merging uses
+// those to decide most comparisons without touching characters, and only
+// scans past a prefix that both candidates are known to share.
+template <class Str, class Tracer>
+void lcpMergeSort(std::vector<Str>& a, std::vector<size_t>& lcp, size_t lo, size_t hi,
+                  std::vector<Str>& aux, std::vector<size_t>& auxLcp, int depth, int position, Tracer& trace) {
+    if (hi - lo <= 1) {
+        if (hi > lo) lcp[lo] = 0;
+        return;
+    }
+
+    size_t mid = lo + (hi - lo) / 2;
+    lcpMergeSort(a, lcp, lo, mid, aux, auxLcp, depth + 1, position * 2, trace);
+    lcpMergeSort(a, lcp, mid, hi, aux, auxLcp, depth + 1, position * 2 + 1, trace);
+
+    // ha / hb: common prefix of the next left / right string with the last
+    // string written out (the empty string before the first one).
+    size_t i = lo, j = mid, k = 0;
+    size_t ha = 0, hb = 0;
+    while (i < mid && j < hi) {
+        // Unequal prefixes with the last output decide the order outright;
+        // only a tie needs characters compared, starting after the tie.
+        bool tie = ha == hb;
+        size_t h = ha;
+        bool takeLeft = ha > hb;
+        if (tie) {
+            h = lcpFrom(keyView(a[i]), keyView(a[j]), ha);
+            takeLeft = charAt(keyView(a[i]), h) <= charAt(keyView(a[j]), h);
+        }
+
+        if (takeLeft) {
+            auxLcp[k] = ha;
+            aux[k++] = std::move(a[i++]);
+            if (tie) hb = h;
+            ha = i < mid ? lcp[i] : 0;
+        } else {
+            auxLcp[k] = hb;
+            aux[k++] = std::move(a[j++]);
+            if (tie) ha = h;
+            hb = j < hi ? lcp[j] : 0;
+        }
+    }
+    if (i < mid) {
+        auxLcp[k] = ha;
+        aux[k++] = std::move(a[i++]);
+        while (i < mid) {
+            auxLcp[k] = lcp[i];
+            aux[k++] = std::move(a[i++]);
+        }
+    }
+    if (j < hi) {
+        auxLcp[k] = hb;
+        aux[k++] = std::move(a[j++]);
+        while (j < hi) {
+            auxLcp[k] = lcp[j];
+            aux[k++] = std::move(a[j++]);
+        }
+    }
+
+    for (size_t t = 0; t < k; ++t) {
+        a[lo + t] = std::move(aux[t]);
+        lcp[lo + t] = auxLcp[t];
+    }
+    lcp[lo] = 0;
+
+    trace.step(a, msg::Message(msg::LcpMerged, lo, hi - 1), depth, position, "merge", -1, (int)lo, (int)hi - 1);
+}
+
+template <class Str, class Tracer>
+void lcpMergeSort(std::vector<Str>& a, Tracer& trace) {
+    std::vector<size_t> lcp(a.size()), auxLcp(a.size());
+    std::vector<Str> aux(a.size());
+    lcpMergeSort(a, lcp, 0, a.size(), aux, auxLcp, 1, 0, trace);
+}
+
+} // namespace strsort
@@ -0,0 +1,153 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iterator>
+#include <chrono>
+#include "trace_writer.h"
+#include "tracer.h"
+#include "suffix_array.h"
+
+using namespace std;
+
+void writeArray(ostringstream& out, const vector<int>& values) {
+    out << "[";
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (i) out << ", ";
+        out << values[i];
+    }
+    out << "]";
+}
+
+void logStep(const string& stage, int l, int r, const vector<int>& array, const string& message) {
+    ostringstream out;
+    out << "{";
+    out << "\"type\":\"SuffixArray\", ";
+    out << "\"stage\":\"" << stage << "\", ";
+    if (l >= 0) out << "\"l\":" << l << ", ";
+    if (r >= 0) out << "\"r\":" << r << ", ";
+    if (!array.empty()) {
+        out << "\"array\":";
+        writeArray(out, array);
+        out << ", ";
+    }
+    out << "\"message\":\"" << message << "\"";
+    out << "}";
+    trace::emit(out.str());
+}
+
+// Streams every step to the visualizer.
+struct StreamTracer {
+    static constexpr bool enabled = true;
+
+    template <class Message>
+    void step(const char* stage, int l, int r, const vector<int>& array, Message&& message) {
+        logStep(stage, l, r, array, message());
+    }
+};
+
+void printMatch(const string& pattern, const textindex::TextIndex& index, pair<int, int> range, size_t limit, double micros) {
+    ostringstream out;
+    out << "{";
+    out << "\"type\":\"match\", ";
+    out << "\"pattern\":" << jsonString(pattern) << ", ";
+    out << "\"count\":" << range.second - range.first << ", ";
+    out << "\"locations\":";
+    writeArray(out, index.locations(range, limit));
+    out << ", ";
+    out << "\"micros\":" << micros;
+    out << "}";
+    trace::emit(out.str());
+}
+
+// Searches the index for each pattern; with no patterns given, reads one per
+// line from stdin.
+void runSearch(const textindex::TextIndex& index, vector<string> patterns, size_t limit) {
+    if (patterns.empty()) {
+        string line;
+        while (getline(cin, line)) patterns.push_back(line);
+    }
+    NullTracer none;
+    for (const string& pattern : patterns) {
+        auto start = chrono::steady_clock::now();
+        auto range = index.find(pattern, none);
+        double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+        printMatch(pattern, index, range, limit, micros);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    // Leading options:
+    //   --limit=<k>    report at most k locations per pattern (default 100)
+    size_t limit = 100;
+    int first = 1;
+    try {
+        for (; first < argc && string(argv[first]).rfind("--", 0) == 0; ++first) {
+            string option = argv[first];
+            if (option.rfind("--limit=", 0) == 0) {
+                try {
+                    limit = stoul(option.substr(8));
+                } catch (const logic_error&) {
+                    throw invalid_argument("Not a number: " + option);
+                }
+            } else {
+                cerr << "Unknown option " << option << endl;
+                return 1;
+            }
+        }
+        string mode = first < argc ? argv[first] : "";
+
+        if (mode == "build") {
+            // build <index-file> [text]: index the text (stdin if omitted) and save it.
+            if (argc <= first + 1) {
+                cerr << "build needs an index file." << endl;
+                return 1;
+            }
+            string text;
+            if (argc > first + 2) text = argv[first + 2];
+            else text.assign(istreambuf_iterator<char>(cin), istreambuf_iterator<char>());
+
+            auto start = chrono::steady_clock::now();
+            NullTracer none;
+            textindex::TextIndex index = textindex::TextIndex::build(move(text), none);
+            index.save(argv[first + 1]);
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            trace::emit("{\"type\":\"index\", \"length\":" + to_string(index.text.size()) + ", \"ms\":" + to_string(ms) + "}");
+            return 0;
+        }
+        if (mode == "search") {
+            // search <index-file> [pattern ...]
+            if (argc <= first + 1) {
+                cerr << "search needs an index file." << endl;
+                return 1;
+            }
+            textindex::TextIndex index = textindex::TextIndex::load(argv[first + 1]);
+            runSearch(index, vector<string>(argv + first + 2, argv + argc), limit);
+            return 0;
+        }
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    // [text] [pattern]: build the index step by step, then search it.
+    string text    = "mississippi";
+    string pattern = "issi";
+    if (argc > first)     text    = argv[first];
+    if (argc > first + 1) pattern = argv[first + 1];
+
+    trace::emit("{\"type\":\"SuffixArray\", \"stage\":\"start\", \"text\":" + jsonString(text) + ", \"pattern\":" +
+                jsonString(pattern) + ", \"message\":\"Building the suffix array of the text\"}");
+    SelectedTracer<StreamTracer> tracer;
+    textindex::TextIndex index = textindex::TextIndex::build(text, tracer);
+    tracer.step("suffix-array", -1, -1, index.sa, [] { return "Suffix array complete"; });
+    tracer.step("lcp-array", -1, -1, index.lcp, [] { return "LCP array complete"; });
+
+    auto range = index.find(pattern, tracer);
+    vector<int> found = index.locations(range, limit);
+    tracer.step("found", found.empty() ? -1 : found[0], (int)pattern.size(), found, [&] {
+        return found.empty() ? string("Pattern not found")
+                             : "Pattern found " + to_string(range.second - range.first) + " times";
+    });
+    return 0;
+}
@@ -0,0 +1,275 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "tracer.h"
+
+// Full-text index: suffix array built with SA-IS, LCP array built with
+// Kasai's algorithm, and pattern search by binary search over the suffixes.
+//
+// Building is O(n); after that a pattern of length m is located in
+// O(m log n) character comparisons at worst, and usually close to
+// O(m + log n) because the search never re-compares a prefix it already
+// knows matches both ends of the current range. The index can be saved to
+// disk and loaded again, so a corpus is indexed once and then searched by any
+// number of later runs.
+//
+// Trace points use tracer.step(stage, l, r, array, message): `l` is a text
+// position, `r` a length or rank, and `array` the array the step produced or
+// changed (empty if none).
+namespace textindex {
+
+inline const std::vector<int>& noArray() {
+    static const std::vector<int> empty;
+    return empty;
+}
+
+// Suffix array of s, whose values lie in [0, upper]. Suffixes are classified
+// S (smaller than the next suffix) or L (larger); the leftmost S suffixes of
+// each S run (LMS) are sorted first, by recursion on a string of their names
+// if needed, and every other suffix is then placed by induction from them.
+template <class Tracer>
+std::vector<int> suffixArray(const std::vector<int>& s, int upper, Tracer& trace, int level = 0) {
+    int n = s.size();
+    if (n == 0) return {};
+    if (n == 1) return {0};
+    if (n == 2) return s[0] < s[1] ? std::vector<int>{0, 1} : std::vector<int>{1, 0};
+
+    std::vector<int> sa(n);
+    std::vector<bool> isS(n);
+    for (int i = n - 2; i >= 0; --i) isS[i] = s[i] == s[i + 1] ? isS[i + 1] : s[i] < s[i + 1];
+
+    if constexpr (Tracer::enabled) {
+        std::string types(n, 'L');
+        for (int i = 0; i < n; ++i) if (isS[i]) types[i] = 'S';
+        trace.step("types", -1, -1, noArray(), [&] { return "Level " + std::to_string(level) + ": suffix types " + types; });
+    }
+
+    // Bucket boundaries per character: L suffixes fill a bucket from its
+    // start (bucketL), S suffixes from its end (bucketS marks where they begin).
+    std::vector<int> bucketL(upper + 2), bucketS(upper + 2);
+    for (int i = 0; i < n; ++i) {
+        if (!isS[i]) bucketS[s[i]]++;
+        else bucketL[s[i] + 1]++;
+    }
+    for (int c = 0; c <= upper; ++c) {
+        bucketS[c] += bucketL[c];
+        bucketL[c + 1] += bucketS[c];
+    }
+
+    auto induce = [&](const std::vector<int>& lms) {
+        std::fill(sa.begin(), sa.end(), -1);
+        std::vector<int> next(bucketS.begin(), bucketS.end());
+        for (int p : lms) sa[next[s[p]]++] = p;
+        next.assign(bucketL.begin(), bucketL.end());
+        sa[next[s[n - 1]]++] = n - 1;
+        for (int i = 0; i < n; ++i) {
+            int v = sa[i];
+            if (v >= 1 && !isS[v - 1]) sa[next[s[v - 1]]++] = v - 1;
+        }
+        next.assign(bucketL.begin(), bucketL.end());
+        for (int i = n - 1; i >= 0; --i) {
+            int v = sa[i];
+            if (v >= 1 && isS[v - 1]) sa[--next[s[v - 1] + 1]] = v - 1;
+        }
+    };
+
+    std::vector<int> lmsName(n + 1, -1), lms;
+    for (int i = 1; i < n; ++i) {
+        if (!isS[i - 1] && isS[i]) {
+            lmsName[i] = lms.size();
+            lms.push_back(i);
+        }
+    }
+    trace.step("lms", -1, -1, lms, [&] { return "Level " + std::to_string(level) + ": " + std::to_string(lms.size()) + " LMS suffixes"; });
+
+    induce(lms);
+    trace.step("induce", -1, -1, sa, [&] { return "Level " + std::to_string(level) + ": induced order of LMS substrings"; });
+
+    int m = lms.size();
+    if (m == 0) return sa;
+
+    // Name each LMS substring by its rank among distinct substrings; equal
+    // neighbours in induced order get the same name.
+    std::vector<int> sortedLms;
+    sortedLms.reserve(m);
+    for (int v : sa) if (lmsName[v] != -1) sortedLms.push_back(v);
+    std::vector<int> reduced(m);
+    int names = 0;
+    reduced[lmsName[sortedLms[0]]] = 0;
+    for (int i = 1; i < m; ++i) {
+        int l = sortedLms[i - 1], r = sortedLms[i];
+        int endL = lmsName[l] + 1 < m ? lms[lmsName[l] + 1] : n;
+        int endR = lmsName[r] + 1 < m ? lms[lmsName[r] + 1] : n;
+        bool same = endL - l == endR - r;
+        if (same) {
+            while (l < endL && s[l] == s[r]) ++l, ++r;
+            if (l == n || s[l] != s[r]) same = false;
+        }
+        if (!same) ++names;
+        reduced[lmsName[sortedLms[i]]] = names;
+    }
+    trace.step("reduce", -1, -1, reduced, [&] {
+        return "Level " + std::to_string(level) + ": named LMS substrings, " + std::to_string(names + 1) + " distinct of " + std::to_string(m) +
+               (names + 1 < m ? ", recursing" : ", all distinct");
+    });
+
+    // Sort the LMS suffixes by their names, recursing while names repeat.
+    std::vector<int> order;
+    if (names + 1 < m) {
+        order = suffixArray(reduced, names, trace, level + 1);
+    } else {
+        order.resize(m);
+        for (int i = 0; i < m; ++i) order[reduced[i]] = i;
+    }
+    for (int i = 0; i < m; ++i) sortedLms[i] = lms[order[i]];
+    induce(sortedLms);
+    trace.step("sorted", -1, -1, sa, [&] { return "Level " + std::to_string(level) + ": induced full suffix order from sorted LMS suffixes"; });
+    return sa;
+}
+
+template <class Tracer>
+std::vector<int> suffixArray(std::string_view text, Tracer& trace) {
+    std::vector<int> s(text.begin(), text.end());
+    for (int& c : s) c = static_cast<unsigned char>(c);
+    return suffixArray(s, 255, trace);
+}
+
+// lcp[i]: length of the common prefix of the suffixes at sa[i - 1] and sa[i]
+// (lcp[0] = 0). Kasai: walking suffixes in text order, the common prefix
+// with the previous suffix in sorted order shrinks by at most one per step.
+template <class Tracer>
+std::vector<int> lcpArray(std::string_view text, const std::vector<int>& sa, Tracer& trace) {
+    int n = sa.size();
+    std::vector<int> rank(n), lcp(n);
+    for (int i = 0; i < n; ++i) rank[sa[i]] = i;
+    int h = 0;
+    for (int i = 0; i < n; ++i) {
+        if (h > 0) --h;
+        if (rank[i] == 0) {
+            h = 0;
+            continue;
+        }
+        int j = sa[rank[i] - 1];
+        while (i + h < n && j + h < n && text[i + h] == text[j + h]) ++h;
+        lcp[rank[i]] = h;
+        trace.step("lcp", i, h, lcp, [&] { return "Suffix " + std::to_string(i) + " shares " + std::to_string(h) + " characters with suffix " + std::to_string(j); });
+    }
+    return lcp;
+}
+
+class TextIndex {
+public:
+    std::string text;
+    std::vector<int> sa;
+    std::vector<int> lcp;
+
+    template <class Tracer>
+    static TextIndex build(std::string text, Tracer& trace) {
+        TextIndex index;
+        index.text = std::move(text);
+        index.sa = suffixArray(index.text, trace);
+        index.lcp = lcpArray(index.text, index.sa, trace);
+        return index;
+    }
+
+    // Range [first, last) of suffix-array entries whose suffixes start with
+    // `pattern`; last - first is the number of occurrences.
+    template <class Tracer>
+    std::pair<int, int> find(std::string_view pattern, Tracer& trace) const {
+        int first = bound(pattern, false, trace);
+        int last = bound(pattern, true, trace);
+        return {first, last};
+    }
+
+    // Start positions of up to `limit` occurrences, sorted.
+    std::vector<int> locations(std::pair<int, int> range, size_t limit) const {
+        size_t count = std::min<size_t>(range.second - range.first, limit);
+        std::vector<int> out(sa.begin() + range.first, sa.begin() + range.first + count);
+        std::sort(out.begin(), out.end());
+        return out;
+    }
+
+    void save(const std::string& file) const {
+        FILE* f = std::fopen(file.c_str(), "wb");
+        if (!f) throw std::runtime_error("Cannot write " + file);
+        uint32_t header[2] = {kMagic, (uint32_t)text.size()};
+        bool ok = std::fwrite(header, sizeof header, 1, f) == 1 &&
+                  std::fwrite(text.data(), 1, text.size(), f) == text.size() &&
+                  std::fwrite(sa.data(), sizeof(int), sa.size(), f) == sa.size() &&
+                  std::fwrite(lcp.data(), sizeof(int), lcp.size(), f) == lcp.size();
+        ok = std::fclose(f) == 0 && ok;
+        if (!ok) throw std::runtime_error("Failed writing " + file);
+    }
+
+    static TextIndex load(const std::string& file) {
+        FILE* f = std::fopen(file.c_str(), "rb");
+        if (!f) throw std::runtime_error("Cannot read " + file);
+        TextIndex index;
+        uint32_t header[2];
+        bool ok = std::fread(header, sizeof header, 1, f) == 1 && header[0] == kMagic;
+        if (ok) {
+            size_t n = header[1];
+            index.text.resize(n);
+            index.sa.resize(n);
+            index.lcp.resize(n);
+            ok = std::fread(index.text.data(), 1, n, f) == n &&
+                 std::fread(index.sa.data(), sizeof(int), n, f) == n &&
+                 std::fread(index.lcp.data(), sizeof(int), n, f) == n;
+        }
+        std::fclose(f);
+        if (!ok) throw std::runtime_error(file + " is not a text index");
+        return index;
+    }
+
+private:
+    static constexpr uint32_t kMagic = 0x31585453;  // "STX1"
+
+    // Compares pattern with the suffix at `pos`, skipping the first `known`
+    // characters. Returns <0, 0 (pattern is a prefix of the suffix) or >0,
+    // and sets `matched` to the length of the common prefix.
+    int compare(std::string_view pattern, int pos, int known, int& matched) const {
+        int n = text.size(), m = pattern.size();
+        int k = known;
+        while (k < m && pos + k < n && pattern[k] == text[pos + k]) ++k;
+        matched = k;
+        if (k == m) return 0;
+        if (pos + k == n) return 1;
+        return (unsigned char)pattern[k] < (unsigned char)text[pos + k] ? -1 : 1;
+    }
+
+    // First suffix that is >= pattern (upper = false) or that neither starts
+    // with nor is smaller than pattern (upper = true). lo / hi track how many
+    // characters the suffixes at the range ends share with the pattern; every
+    // suffix between them shares at least the smaller of the two.
+    template <class Tracer>
+    int bound(std::string_view pattern, bool upper, Tracer& trace) const {
+        int lo = -1, hi = sa.size();
+        int lcpLo = 0, lcpHi = 0;
+        while (hi - lo > 1) {
+            int mid = lo + (hi - lo) / 2;
+            int matched;
+            int c = compare(pattern, sa[mid], std::min(lcpLo, lcpHi), matched);
+            trace.step("probe", sa[mid], matched, noArray(), [&] {
+                return std::string(upper ? "Upper" : "Lower") + " bound: suffix " + std::to_string(sa[mid]) + " (rank " +
+                       std::to_string(mid) + ") matches " + std::to_string(matched) + " characters";
+            });
+            bool goRight = upper ? c >= 0 : c > 0;
+            if (goRight) {
+                lo = mid;
+                lcpLo = matched;
+            } else {
+                hi = mid;
+                lcpHi = matched;
+            }
+        }
+        return hi;
+    }
+};
+
+} // namespace textindex
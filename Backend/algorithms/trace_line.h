@@ -0,0 +1,86 @@
+#pragma once
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "messages.h"
+#include "trace_writer.h"
+
+// One JSON trace line, built in a buffer that is kept from line to line.
+// Once the buffer has grown to the longest line seen, formatting and emitting
+// a step allocates nothing: numbers go through std::to_chars into a stack
+// array and text is appended in place.
+namespace trace {
+
+class Line {
+public:
+    Line& raw(std::string_view text) {
+        buf_.append(text);
+        return *this;
+    }
+
+    template <class T, class = std::enable_if_t<std::is_arithmetic_v<T>>>
+    Line& number(T value) {
+        char digits[32];
+        auto result = std::to_chars(digits, digits + sizeof digits, value);
+        buf_.append(digits, result.ptr);
+        return *this;
+    }
+
+    // A JSON string; quotes and backslashes are escaped, control characters
+    // become spaces.
+    Line& quoted(std::string_view text) {
+        buf_ += '"';
+        for (char c : text) {
+            if (c == '"' || c == '\\') buf_ += '\\';
+            buf_ += (unsigned char)c < 0x20 ? ' ' : c;
+        }
+        buf_ += '"';
+        return *this;
+    }
+
+    // An array element: text quoted, numbers as they are.
+    Line& value(std::string_view text) { return quoted(text); }
+    template <class T, class = std::enable_if_t<std::is_arithmetic_v<T>>>
+    Line& value(T number) { return this->number(number); }
+
+    template <class Range>
+    Line& array(const Range& values) {
+        buf_ += '[';
+        bool first = true;
+        for (const auto& v : values) {
+            if (!first) buf_.append(", ");
+            first = false;
+            value(v);
+        }
+        buf_ += ']';
+        return *this;
+    }
+
+    // "msg": <id>, "args": [...], or without the spaces if not `spaced`, to
+    // match the rest of the line.
+    Line& message(const msg::Message& m, bool spaced = true) {
+        std::string_view comma = spaced ? ", " : ",";
+        raw(spaced ? "\"msg\": " : "\"msg\":").number((int)m.id).raw(comma).raw(spaced ? "\"args\": [" : "\"args\":[");
+        for (int k = 0; k < m.count; ++k) {
+            if (k) raw(comma);
+            number(m.args[k]);
+        }
+        buf_ += ']';
+        return *this;
+    }
+
+    std::string_view view() const { return buf_; }
+    void clear() { buf_.clear(); }
+
+    // Hands the line to the trace writer and starts the next one.
+    void emit() {
+        trace::emit(buf_);
+        buf_.clear();
+    }
+
+private:
+    std::string buf_;
+};
+
+} // namespace trace
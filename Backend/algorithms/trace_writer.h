@@ -0,0 +1,193 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+// Asynchronous trace sink shared by every algorithm binary.
+//
+// The algorithm thread hands finished trace lines to a single-producer /
+// single-consumer ring of fixed-size slots and keeps going; a dedicated writer
+// thread drains the ring and issues batched writes to stdout. A line longer
+// than one slot is spread over consecutive slots; readers must therefore
+// reassemble lines rather than assume one line per read.
+//
+// When the ring is full the producer either waits for the writer (default) or
+// drops the whole line, selected with TRACE_FULL_POLICY=block|drop. When the
+// ring stays empty the writer parks on an atomic wait (a --step binary can sit
+// idle for a long time) and the producer wakes it only if it is parked.
+namespace trace {
+
+enum class FullPolicy { Block, Drop };
+
+class AsyncWriter {
+public:
+    static constexpr size_t kSlotBytes = 128;
+    static constexpr size_t kSlotCount = 1 << 14;   // 2 MiB of slots
+    static constexpr size_t kBatchBytes = 1 << 16;  // bytes per write call
+
+    AsyncWriter()
+        : slots_(new Slot[kSlotCount]),
+          policy_(readPolicy()),
+          thread_(&AsyncWriter::run, this) {}
+
+    ~AsyncWriter() {
+        done_.store(true, std::memory_order_seq_cst);
+        wake();
+        thread_.join();
+    }
+
+    AsyncWriter(const AsyncWriter&) = delete;
+    AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+    // Queues one line (without its trailing newline). Returns false if the
+    // line was dropped because the ring was full under FullPolicy::Drop.
+    bool push(std::string_view line) {
+        size_t total = line.size() + 1;
+        size_t head = head_.load(std::memory_order_relaxed);
+
+        if (policy_ == FullPolicy::Drop &&
+            freeSlots(head) < (total + kPayload - 1) / kPayload) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        size_t offset = 0;
+        while (offset < total) {
+            size_t available = freeSlots(head);
+            if (available == 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            for (; available > 0 && offset < total; --available, ++head) {
+                Slot& slot = slots_[head & (kSlotCount - 1)];
+                size_t chunk = std::min(kPayload, total - offset);
+                size_t fromLine = offset < line.size() ? std::min(chunk, line.size() - offset) : 0;
+                std::memcpy(slot.data, line.data() + offset, fromLine);
+                if (fromLine < chunk) slot.data[fromLine] = '\n';
+                slot.len = static_cast<uint16_t>(chunk);
+                offset += chunk;
+            }
+            // seq_cst so that either this store is seen by a writer about to
+            // park, or the writer's parked_ flag is seen here.
+            head_.store(head, std::memory_order_seq_cst);
+            if (parked_.load(std::memory_order_seq_cst)) wake();
+        }
+        return true;
+    }
+
+    size_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        uint16_t len;
+        char data[kSlotBytes - sizeof(uint16_t)];
+    };
+    static constexpr size_t kPayload = sizeof(Slot::data);
+
+    size_t freeSlots(size_t head) const {
+        return kSlotCount - (head - tail_.load(std::memory_order_acquire));
+    }
+
+    void wake() {
+        wakeups_.fetch_add(1, std::memory_order_seq_cst);
+        wakeups_.notify_one();
+    }
+
+    static FullPolicy readPolicy() {
+        const char* env = std::getenv("TRACE_FULL_POLICY");
+        return (env && std::strcmp(env, "drop") == 0) ? FullPolicy::Drop : FullPolicy::Block;
+    }
+
+    void run() {
+        std::unique_ptr<char[]> batch(new char[kBatchBytes]);
+        size_t used = 0;
+        int idleSpins = 0;
+
+        for (;;) {
+            size_t tail = tail_.load(std::memory_order_relaxed);
+            size_t head = head_.load(std::memory_order_acquire);
+
+            if (tail == head) {
+                if (used > 0) {
+                    flush(batch.get(), used);
+                    used = 0;
+                }
+                if (done_.load(std::memory_order_acquire) &&
+                    head_.load(std::memory_order_acquire) == tail) break;
+                if (++idleSpins < 64) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                // Park until push() or the destructor bumps wakeups_. Reading
+                // it before raising parked_ means a wake() in between is not
+                // lost: wait() returns at once if the count has moved.
+                uint32_t seen = wakeups_.load(std::memory_order_seq_cst);
+                parked_.store(true, std::memory_order_seq_cst);
+                if (head_.load(std::memory_order_seq_cst) == tail && !done_.load(std::memory_order_seq_cst)) {
+                    wakeups_.wait(seen, std::memory_order_seq_cst);
+                }
+                parked_.store(false, std::memory_order_relaxed);
+                idleSpins = 0;
+                continue;
+            }
+            idleSpins = 0;
+
+            for (; tail != head; ++tail) {
+                const Slot& slot = slots_[tail & (kSlotCount - 1)];
+                if (used + slot.len > kBatchBytes) {
+                    flush(batch.get(), used);
+                    used = 0;
+                }
+                std::memcpy(batch.get() + used, slot.data, slot.len);
+                used += slot.len;
+            }
+            tail_.store(tail, std::memory_order_release);
+        }
+    }
+
+    static void flush(const char* data, size_t size) {
+        std::fwrite(data, 1, size, stdout);
+        std::fflush(stdout);
+    }
+
+    std::unique_ptr<Slot[]> slots_;
+    FullPolicy policy_;
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+    alignas(64) std::atomic<size_t> dropped_{0};
+    std::atomic<bool> done_{false};
+    alignas(64) std::atomic<bool> parked_{false};
+    std::atomic<uint32_t> wakeups_{0};
+    std::thread thread_;
+};
+
+inline AsyncWriter& writer() {
+    static AsyncWriter instance;
+    return instance;
+}
+
+inline void emit(std::string_view line) {
+    writer().push(line);
+}
+
+} // namespace trace
+
+// `text` as a JSON string literal, for binaries that build lines by hand:
+// quotes and backslashes are escaped, control characters become spaces.
+inline std::string jsonString(std::string_view text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') { out += '\\'; out += c; }
+        else if ((unsigned char)c < 0x20) out += ' ';
+        else out += c;
+    }
+    return out + "\"";
+}
+
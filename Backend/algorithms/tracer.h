@@ -0,0 +1,29 @@
+#pragma once
+
+// Tracer policies.
+//
+// Algorithms take a Tracer template parameter and report every step through
+// tracer.step(...). Each binary supplies a streaming tracer that formats steps
+// for the visualizer; NullTracer accepts any step and does nothing, so a build
+// that selects it compiles the trace points away entirely.
+//
+// To keep that true, step messages are passed either as msg::Message values
+// (an ID and integer arguments, see messages.h) or as lambdas that only an
+// enabled tracer invokes, and work done purely for tracing (copying a
+// sub-array to show it, say) is wrapped in `if constexpr (Tracer::enabled)`.
+struct NullTracer {
+    static constexpr bool enabled = false;
+
+    template <class... Args>
+    void step(Args&&...) const noexcept {}
+};
+
+// Build with -DTRACE_DISABLED to get the untraced, full-speed binary from the
+// same source: SelectedTracer<StreamTracer> then resolves to NullTracer.
+#ifdef TRACE_DISABLED
+template <class Stream>
+using SelectedTracer = NullTracer;
+#else
+template <class Stream>
+using SelectedTracer = Stream;
+#endif
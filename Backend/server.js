@@ -2,37 +2,276 @@ const express = require('express');
 const cors = require('cors');
 const { spawn } = require('child_process');
 const path = require('path');
+const fs = require('fs');
+const crypto = require('crypto');
+const os = require('os');
+const { TraceLog, attachTraceSocket } = require('./trace_socket');
 
 const app = express();
 app.use(cors());
-app.use(express.json());
+// Batch requests carry thousands of inputs.
+app.use(express.json({ limit: '50mb' }));
 
 let clients = [];
 let lastChoice = '';
 let userParams = [];
 
+// Algorithms whose binaries accept --step and advance only when asked to.
+const STEPPABLE = new Set(['bubble-sort', 'n-queen', 'hamiltonian_cycle']);
+// Element types SortingAlgorithm.exe accepts via --type.
+const ELEMENT_TYPES = new Set(['int', 'int64', 'double', 'string']);
+// How long a step-mode run may sit without any listener before it is killed.
+const STEP_IDLE_MS = 30000;
+// Algorithms whose binaries accept --session and redo only what an edit to
+// the input changes (see algorithms/session_state.h). Each page session
+// keeps one state file per algorithm here.
+const SESSIONFUL = new Set(['dp-knapsack', 'greedy-dijkstra', 'string-kmp']);
+const SESSION_DIR = path.join(os.tmpdir(), 'algorithm-sessions');
+// Worker threads a batch or distance-matrix request may ask for: the
+// binaries run at most one per core.
+const MAX_THREADS = Math.max(1, os.availableParallelism?.() ?? os.cpus().length);
+
+let stepMode = false;
+let elementType = 'int';
+let routeOptions = [];
+let sessionOptions = [];
+let activeChild = null;
+let idleTimer = null;
+// Every line of the latest run, for the WebSocket transport (trace_socket.js).
+let traceLog = null;
+let runCounter = 0;
+
 app.post('/run-:algorithm', (req, res) => {
   const { algorithm } = req.params;
+  const params = req.body.array ?? [];
+  const type = ELEMENT_TYPES.has(req.body.type) ? req.body.type : 'int';
+  if (!Array.isArray(params)) return res.status(400).send('array must be an array');
+  // Sorts pack their values for the binary, so bad ones are caught here
+  // rather than after the run has been announced.
+  const invalid = SORTS.has(algorithm) ? params.find((v) => !validElement(type, v)) : undefined;
+  if (invalid !== undefined) return res.status(400).send(`Not a valid ${type}: ${JSON.stringify(invalid)}`);
+
   lastChoice = algorithm;
-  userParams = req.body.array || [];
+  userParams = params;
+  stepMode = Boolean(req.body.stepMode) && STEPPABLE.has(algorithm);
+  elementType = type;
+  routeOptions = [];
+  if (Number.isInteger(req.body.source)) routeOptions.push(`--from=${req.body.source}`);
+  if (Number.isInteger(req.body.target)) routeOptions.push(`--to=${req.body.target}`);
+  if (req.body.bidirectional) routeOptions.push('--bidirectional');
+  sessionOptions = [];
+  if (SESSIONFUL.has(algorithm) && /^[A-Za-z0-9_-]{1,64}$/.test(req.body.session ?? '')) {
+    fs.mkdirSync(SESSION_DIR, { recursive: true });
+    sessionOptions.push(`--session=${path.join(SESSION_DIR, `${req.body.session}-${algorithm}.state`)}`);
+  }
 
-  console.log(`Running ${algorithm} with params:`, userParams);
-  res.sendStatus(200);
+  console.log(`Running ${algorithm} with params:`, userParams, stepMode ? '(step mode)' : '');
+  res.json({ stepMode });
 
   startProcess();
 });
 
+// Step mode: ask the running binary for its next `count` steps.
+app.post('/next', (req, res) => {
+  if (!stepMode || !activeChild) return res.sendStatus(409);
+
+  const count = Math.max(1, parseInt(req.body.count, 10) || 1);
+  activeChild.stdin.write(`next ${count}\n`);
+  res.sendStatus(200);
+});
+
 app.get('/stream', (req, res) => {
   res.setHeader('Content-Type', 'text/event-stream');
   res.setHeader('Cache-Control', 'no-cache');
   res.setHeader('Connection', 'keep-alive');
 
   clients.push(res);
+  clearTimeout(idleTimer);
   req.on('close', () => {
     clients = clients.filter(c => c !== res);
+    // An abandoned step-mode run is suspended on stdin; don't keep it forever.
+    if (stepMode && clients.length === 0) {
+      idleTimer = setTimeout(stopActiveChild, STEP_IDLE_MS);
+    }
   });
 });
 
+// SortingAlgorithm.exe's algorithms, all of which also accept --batch.
+const SORTS = new Set([
+  'merge-sort', 'quick-sort', 'bubble-sort', 'selection-sort', 'insertion-sort',
+  'counting-sort', 'radix-sort', 'msd-radix-sort', 'multikey-quicksort', 'lcp-merge-sort',
+]);
+// Other binaries that accept --batch: one input per stdin line, one frame per input.
+const BATCH_BINARIES = {
+  'dp-knapsack': 'knapsack.exe',
+  'string-kmp': 'kmp.exe',
+  'string-rabin': 'rabin_karp.exe',
+};
+
+// Batch mode: run many inputs for one algorithm in a single process spread
+// over all cores. Body: { inputs: [[...fields], ...], traces?, type?, threads? }.
+// Responds with the binary's NDJSON frames as they are produced (see
+// algorithms/batch.h), ending with a {"batch": "end", ...} summary.
+app.post('/batch/:algorithm', (req, res) => {
+  const { algorithm } = req.params;
+  const { inputs, traces, type, threads } = req.body;
+  if (!Array.isArray(inputs) || !inputs.every(Array.isArray)) {
+    return res.status(400).send('inputs must be an array of field arrays');
+  }
+
+  const algoDir = path.resolve(__dirname, 'algorithms');
+  const args = [traces ? '--batch-traces' : '--batch'];
+  if (Number.isInteger(threads) && threads > 0) args.push(`--threads=${Math.min(threads, MAX_THREADS)}`);
+  let exePath;
+  if (SORTS.has(algorithm)) {
+    exePath = path.join(algoDir, 'SortingAlgorithm.exe');
+    args.push(`--type=${ELEMENT_TYPES.has(type) ? type : 'int'}`, algorithm);
+  } else if (BATCH_BINARIES[algorithm]) {
+    exePath = path.join(algoDir, BATCH_BINARIES[algorithm]);
+  } else {
+    return res.status(404).send(`No batch mode for ${algorithm}`);
+  }
+
+  const child = spawn(exePath, args);
+  child.stdin.on('error', () => {});
+  child.on('error', (err) => {
+    console.error('Spawn error:', err);
+    if (!res.headersSent) res.status(500).send(err.message);
+    else res.end();
+  });
+  res.on('close', () => child.kill());
+
+  res.setHeader('Content-Type', 'application/x-ndjson');
+  child.stdout.pipe(res);
+
+  // Tabs and newlines frame the input, so they cannot appear inside a field.
+  const field = (v) => String(v).replace(/[\t\r\n]/g, ' ');
+  child.stdin.end(inputs.map((input) => input.map(field).join('\t')).join('\n') + '\n');
+});
+
+// Landmark indexes built by Greedy.exe alt-build, one file per distinct graph.
+const INDEX_DIR = path.resolve(__dirname, 'indexes');
+
+// Runs an algorithm binary to completion and resolves with its parsed output
+// lines; `input`, if given, is written to its stdin.
+function runBinary(exe, args, input) {
+  return new Promise((resolve, reject) => {
+    const child = spawn(path.join(__dirname, 'algorithms', exe), args);
+    let out = '', err = '';
+    child.stdout.on('data', (d) => { out += d; });
+    child.stderr.on('data', (d) => { err += d; });
+    child.stdin.on('error', () => {});
+    child.stdin.end(input ?? '');
+    child.on('error', reject);
+    child.on('close', (code) => (code === 0
+      ? resolve(out.split('\n').filter(Boolean).map((line) => JSON.parse(line)))
+      : reject(new Error(err.trim() || `exit ${code}`))));
+  });
+}
+
+// Builds `file` with `build` unless it already exists. The build writes under
+// a temporary name so a concurrent request never loads half a file.
+async function ensureIndex(file, build) {
+  if (fs.existsSync(file)) return;
+  fs.mkdirSync(INDEX_DIR, { recursive: true });
+  const partial = `${file}.${process.pid}.${Date.now()}`;
+  await build(partial);
+  fs.renameSync(partial, file);
+}
+
+// Repeated shortest-path queries on one graph. Body: { edges: [u, v, w, ...],
+// queries: [[from, to], ...] }. The first request for a graph builds and saves
+// its landmark index; later ones only load it. Responds with one
+// { from, to, path, cost, settled, micros } object per query.
+app.post('/shortest-paths', async (req, res) => {
+  const { edges, queries } = req.body;
+  if (!Array.isArray(edges) || edges.length % 3 !== 0 || !edges.every(Number.isInteger) ||
+      !Array.isArray(queries) || !queries.every((q) => Array.isArray(q) && q.length === 2 && q.every(Number.isInteger))) {
+    return res.status(400).send('edges must be u v w triplets and queries [from, to] pairs');
+  }
+
+  const key = crypto.createHash('sha1').update(edges.join(',')).digest('hex');
+  const indexFile = path.join(INDEX_DIR, `${key}.alt`);
+  try {
+    await ensureIndex(indexFile, (file) => runBinary('Greedy.exe', ['alt-build', file, ...edges.map(String)]));
+    const out = await runBinary('Greedy.exe', ['alt-query', indexFile, ...queries.flat().map(String)]);
+    res.json(out.filter((d) => d.type === 'query'));
+  } catch (err) {
+    res.status(500).send(err.message);
+  }
+});
+
+// Distance matrix between many sources and every node, computed on all cores.
+// Body: { edges: [u, v, w, ...], sources?: [id, ...], kernel?, threads? };
+// sources default to every node, kernel to auto (see algorithms/all_pairs.h).
+// Responds with Greedy.exe's NDJSON as it is produced: a "matrix" header,
+// compressed "tile" lines in any order, and a "matrix-end" summary.
+app.post('/distance-matrix', (req, res) => {
+  const { edges, sources, kernel, threads } = req.body;
+  if (!Array.isArray(edges) || edges.length % 3 !== 0 || !edges.every(isInt32) ||
+      (sources !== undefined && !(Array.isArray(sources) && sources.every(isInt32)))) {
+    return res.status(400).send('edges must be u v w triplets and sources node ids, all 32-bit integers');
+  }
+
+  const args = ['--stdin-format=i32'];
+  if (sources?.length) args.push(`--sources=${sources.join(',')}`);
+  if (['auto', 'dijkstra', 'floyd-warshall'].includes(kernel)) args.push(`--kernel=${kernel}`);
+  if (Number.isInteger(threads) && threads > 0) args.push(`--threads=${Math.min(threads, MAX_THREADS)}`);
+  const child = spawn(path.join(__dirname, 'algorithms', 'Greedy.exe'), [...args, 'all-pairs']);
+  child.stdin.on('error', () => {});
+  child.on('error', (err) => {
+    console.error('Spawn error:', err);
+    if (!res.headersSent) res.status(500).send(err.message);
+    else res.end();
+  });
+  res.on('close', () => child.kill());
+
+  res.setHeader('Content-Type', 'application/x-ndjson');
+  child.stdout.pipe(res);
+
+  const data = Buffer.alloc(edges.length * 4);
+  edges.forEach((v, i) => data.writeInt32LE(v, i * 4));
+  child.stdin.end(data);
+});
+
+// Full-text index for repeated searches over one text. Body: { text }.
+// Responds with { id } to pass to /text-search; indexing the same text again
+// reuses the saved index.
+app.post('/text-index', async (req, res) => {
+  const { text } = req.body;
+  if (typeof text !== 'string') return res.status(400).send('text must be a string');
+
+  const id = crypto.createHash('sha1').update(text).digest('hex');
+  try {
+    await ensureIndex(path.join(INDEX_DIR, `${id}.stx`), (file) => runBinary('suffix_array.exe', ['build', file], text));
+    res.json({ id });
+  } catch (err) {
+    res.status(500).send(err.message);
+  }
+});
+
+// Body: { id, patterns: [...], limit? }. Responds with one
+// { pattern, count, locations, micros } object per pattern.
+app.post('/text-search', async (req, res) => {
+  const { id, patterns, limit } = req.body;
+  if (!/^[0-9a-f]{40}$/.test(id || '') || !Array.isArray(patterns) || !patterns.every((p) => typeof p === 'string')) {
+    return res.status(400).send('id must come from /text-index and patterns must be strings');
+  }
+  const indexFile = path.join(INDEX_DIR, `${id}.stx`);
+  if (!fs.existsSync(indexFile)) return res.status(404).send('Unknown text index');
+  if (patterns.length === 0) return res.json([]);
+
+  const args = ['search', indexFile];
+  if (Number.isInteger(limit) && limit >= 0) args.unshift(`--limit=${limit}`);
+  try {
+    // Patterns go one per line on stdin, so they cannot contain newlines.
+    const out = await runBinary('suffix_array.exe', args, patterns.map((p) => p.replace(/[\r\n]/g, ' ')).join('\n') + '\n');
+    res.json(out.filter((d) => d.type === 'match'));
+  } catch (err) {
+    res.status(500).send(err.message);
+  }
+});
+
 app.get('/pseudocode/:algorithm', (req, res) => {
   const algorithm = req.params.algorithm;
   const pseudocode = require(`./algorithms/pseudocode.json`);
@@ -43,13 +282,76 @@ app.get('/pseudocode/:algorithm', (req, res) => {
   }
 });
 
+// Step message templates, indexed by the "msg" ID that sorting, greedy and
+// backtracking steps carry instead of text (see algorithms/messages.h).
+app.get('/messages', (req, res) => {
+  res.json(require('./algorithms/messages.json'));
+});
+
+
+function stopActiveChild() {
+  if (activeChild) {
+    activeChild.kill();
+    activeChild = null;
+  }
+}
+
+const INT32_MIN = -(2 ** 31), INT32_MAX = 2 ** 31 - 1;
+const INT64_MIN = -(2n ** 63n), INT64_MAX = 2n ** 63n - 1n;
+const isInt32 = (v) => Number.isInteger(v) && v >= INT32_MIN && v <= INT32_MAX;
+
+// Whether `v` (a number or numeric string from a request) is a value of the
+// element type, as SortingAlgorithm.exe would parse it.
+function validElement(type, v) {
+  if (type === 'string') return typeof v === 'string' || typeof v === 'number';
+  if (typeof v !== 'number' && !(typeof v === 'string' && v.trim() !== '')) return false;
+  if (type === 'double') return Number.isFinite(Number(v));
+  const text = String(v).trim();
+  if (!/^-?\d+$/.test(text)) return false;
+  if (type === 'int') return isInt32(Number(text));
+  const big = BigInt(text);
+  return big >= INT64_MIN && big <= INT64_MAX;
+}
+
+// Bulk stdin input (see algorithms/bulk_input.h): the data goes to the binary
+// in one write instead of one argument per value, so it is not limited by
+// ARG_MAX and the binary parses it without per-value conversions. Values
+// must pass validElement. Every traced step repeats the whole array, so inputs
+// longer than TRACED_SORT_LIMIT are sorted without steps (--trace-limit): the
+// run shows only the initial and the sorted array.
+const TRACED_SORT_LIMIT = 1000;
+function sortInput(type, values) {
+  if (type === 'int' || type === 'int64') {
+    const width = type === 'int' ? 4 : 8;
+    const data = Buffer.alloc(values.length * width);
+    values.forEach((v, i) => {
+      if (width === 4) data.writeInt32LE(Number(String(v).trim()), i * 4);
+      else data.writeBigInt64LE(BigInt(String(v).trim()), i * 8);
+    });
+    return { format: type === 'int' ? 'i32' : 'i64', data };
+  }
+  // Doubles as text, strings one per line.
+  const lines = values.map((v) => String(v).replace(/[\r\n]/g, ' '));
+  return { format: type === 'string' ? 'utf8' : 'text', data: Buffer.from(lines.join('\n') + '\n') };
+}
+
+// KMP and Rabin-Karp: the pattern on the first line, the text after it.
+function searchInput([text, pattern]) {
+  return { format: 'utf8', data: Buffer.from(`${String(pattern).replace(/[\r\n]/g, ' ')}\n${text}`) };
+}
 
 function startProcess() {
   if (!lastChoice) return;
+  clearTimeout(idleTimer);
+  stopActiveChild();
+  traceLog?.finish('Superseded by a newer run');
+  const log = new TraceLog(`${process.pid}-${++runCounter}`);
+  traceLog = log;
 
   const algoDir = path.resolve(__dirname, 'algorithms');
   let exePath;
   let args = [];
+  let input = null;
 
   switch (lastChoice) {
     case 'dp-fibonacci':
@@ -58,7 +360,19 @@ function startProcess() {
       break;
     case 'dp-knapsack':
       exePath = path.join(algoDir, 'knapsack.exe');
-      args = userParams.map(String);
+      args = [...sessionOptions, ...userParams.map(String)];
+      break;
+    case 'dp-edit-distance':
+      exePath = path.join(algoDir, 'sequence_alignment.exe');
+      args = ['edit', ...userParams.map(String)];
+      break;
+    case 'dp-lcs':
+      exePath = path.join(algoDir, 'sequence_alignment.exe');
+      args = ['lcs', ...userParams.map(String)];
+      break;
+    case 'dp-smith-waterman':
+      exePath = path.join(algoDir, 'sequence_alignment.exe');
+      args = ['local', ...userParams.map(String)];
       break;
     case 'greedy':
       exePath = path.join(algoDir, 'Greedy.exe');
@@ -70,16 +384,25 @@ function startProcess() {
       args = userParams.map(String);
       break;
     case 'string-kmp':
-      exePath = path.join(algoDir, 'kmp.exe');
-      args = userParams.map(String);
-      break;
     case 'string-rabin':
-      exePath = path.join(algoDir, 'rabin_karp.exe');
+      exePath = path.join(algoDir, lastChoice === 'string-kmp' ? 'kmp.exe' : 'rabin_karp.exe');
+      if (userParams.length >= 2) {
+        input = searchInput(userParams);
+        args = [`--stdin-format=${input.format}`];
+      } else {
+        args = userParams.map(String);
+      }
+      if (lastChoice === 'string-kmp') {
+        args = [...sessionOptions, ...args];
+      }
+      break;
+    case 'string-suffix-array':
+      exePath = path.join(algoDir, 'suffix_array.exe');
       args = userParams.map(String);
       break;
     case 'greedy-dijkstra':
       exePath = path.join(algoDir, 'Greedy.exe');
-      args = ['dijkstra', ...userParams.map(String)];
+      args = [...routeOptions, ...sessionOptions, 'dijkstra', ...userParams.map(String)];
       break;
 
     case 'greedy-prims':
@@ -98,23 +421,50 @@ function startProcess() {
     default:
       // Generic algorithms
       exePath = path.join(algoDir, 'SortingAlgorithm.exe');
-      args = [lastChoice, ...userParams.map(String)];
+      // Step mode reads its commands from stdin, so its input stays in argv.
+      if (!stepMode && userParams.length > 0) {
+        input = sortInput(elementType, userParams);
+        args = [`--type=${elementType}`, `--stdin-format=${input.format}`,
+          `--trace-limit=${TRACED_SORT_LIMIT}`, lastChoice];
+      } else {
+        args = [`--type=${elementType}`, lastChoice, ...userParams.map(String)];
+      }
       break;
   }
 
+  if (stepMode) args = ['--step', ...args];
+
   console.log('Spawning:', exePath, 'Args:', args);
 
   const child = spawn(exePath, args);
+  activeChild = child;
+  // A step-mode binary may exit while a /next is still being written.
+  child.stdin.on('error', () => {});
+  if (input) child.stdin.end(input.data);
 
+  // The trace writer flushes in large batches, so a chunk can end mid-line;
+  // keep the unfinished tail until the rest of it arrives.
+  let pending = '';
   child.stdout.on('data', (data) => {
-    const lines = data.toString().split('\n').filter(Boolean);
-    lines.forEach(line => {
+    if (activeChild !== child) return; // superseded by a newer run
+    const lines = (pending + data.toString()).split('\n');
+    pending = lines.pop();
+    lines.filter(Boolean).forEach(line => {
+      log.append(line);
       clients.forEach(client => client.write(`data: ${line}\n\n`));
     });
   });
 
   child.on('close', (code) => {
     console.log(`Exited with code ${code}`);
+    if (activeChild !== child) return;
+    activeChild = null;
+    if (pending) {
+      log.append(pending);
+      clients.forEach(client => client.write(`data: ${pending}\n\n`));
+      pending = '';
+    }
+    log.finish();
     clients.forEach(c => {
       c.write('event: end\ndata: done\n\n');
       c.end();
@@ -124,6 +474,9 @@ function startProcess() {
 
   child.on('error', (err) => {
     console.error('Spawn error:', err);
+    if (activeChild !== child) return;
+    activeChild = null;
+    log.finish(err.message);
     clients.forEach(c => {
       c.write(`event: error\ndata: ${JSON.stringify(err.message)}\n\n`);
       c.end();
@@ -132,4 +485,5 @@ function startProcess() {
   });
 }
 
-app.listen(5000, () => console.log('Server running on http://localhost:5000'));
+const server = app.listen(5000, () => console.log('Server running on http://localhost:5000'));
+attachTraceSocket(server, () => traceLog);
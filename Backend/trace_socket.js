@@ -0,0 +1,208 @@
+const { EventEmitter } = require('events');
+const { Server } = require('socket.io');
+
+// Trace delivery over binary WebSocket frames, as an alternative to /stream
+// (one SSE message per step).
+//
+// Every run's lines are kept in a TraceLog so a client can start late or
+// resume after a reconnect. A TraceLog holds at most MAX_LOG_CHARS of the
+// newest lines; older ones are dropped, and a session that still needed them
+// continues at the oldest line left, so its next frame's `first` skips ahead.
+// A client session sends many steps per frame:
+//
+//   client -> 'subscribe' { run?, from?, window?, maxBytes? }
+//       run/from resume an earlier subscription at step `from` if `run` is
+//       still the current run; otherwise delivery starts at the oldest step
+//       kept (0 unless the log has dropped lines).
+//   server -> 'run'   { run, from }        where delivery starts
+//   server -> 'steps' { first, count }, <binary: count lines joined by '\n'>
+//   client -> 'ack'                        one frame consumed
+//   client -> 'window' n                   resize the credit window
+//   server -> 'end'   { total, error? }    every step has been delivered
+//
+// Each frame uses one credit and the client returns it with 'ack' once the
+// frame is decoded and rendered, so at most `window` frames are in flight.
+// Frames are only cut when there is credit, and everything produced since the
+// last frame goes into the next one (up to maxBytes), so the frame rate
+// follows whichever of the network and the client is slower rather than the
+// number of steps the algorithm emits. Frames are compressed with
+// permessage-deflate.
+
+// Coalescing delay for new steps when the client has credit to spare: about
+// one display frame.
+const FRAME_INTERVAL_MS = 16;
+const DEFAULT_WINDOW = 4;
+const MAX_WINDOW = 64;
+const DEFAULT_FRAME_BYTES = 256 * 1024;
+const MAX_FRAME_BYTES = 4 * 1024 * 1024;
+// Characters of trace a TraceLog keeps, counting one per line for the
+// newline; steps are a few hundred characters, so this is several hundred
+// thousand of them.
+const MAX_LOG_CHARS = 128 * 1024 * 1024;
+
+// Lines are numbered from 0 for the whole run; [start, end) are still held.
+class TraceLog extends EventEmitter {
+  constructor(id, maxChars = MAX_LOG_CHARS) {
+    super();
+    this.setMaxListeners(0); // one listener per session
+    this.id = id;
+    this.maxChars = maxChars;
+    this.lines = [];
+    this.head = 0; // index in `lines` of line `start`
+    this.start = 0;
+    this.chars = 0;
+    this.done = false;
+    this.error = null;
+  }
+
+  get end() {
+    return this.start + this.lines.length - this.head;
+  }
+
+  line(i) {
+    return this.lines[i - this.start + this.head];
+  }
+
+  append(line) {
+    this.lines.push(line);
+    this.chars += line.length + 1;
+    // Always keep the newest line, however long.
+    while (this.chars > this.maxChars && this.head < this.lines.length - 1) {
+      this.chars -= this.lines[this.head].length + 1;
+      this.lines[this.head++] = undefined;
+      this.start++;
+    }
+    // Compact once the dropped slots outnumber the kept ones.
+    if (this.head > 1024 && this.head * 2 > this.lines.length) {
+      this.lines = this.lines.slice(this.head);
+      this.head = 0;
+    }
+    this.emit('lines');
+  }
+
+  finish(error = null) {
+    if (this.done) return;
+    this.done = true;
+    this.error = error;
+    this.emit('lines');
+  }
+}
+
+function clamp(value, low, high, fallback) {
+  const n = Number.parseInt(value, 10);
+  return Number.isFinite(n) ? Math.min(high, Math.max(low, n)) : fallback;
+}
+
+class Session {
+  constructor(socket, log, { from, window, maxBytes }) {
+    this.socket = socket;
+    this.log = log;
+    this.next = from;
+    this.window = window;
+    this.credit = window;
+    this.maxBytes = maxBytes;
+    this.timer = null;
+    this.ended = false;
+    this.onLines = () => this.schedule();
+    log.on('lines', this.onLines);
+    socket.emit('run', { run: log.id, from });
+    this.schedule();
+  }
+
+  // Sends at once if a full frame is waiting, otherwise gives more steps a
+  // moment to arrive.
+  schedule() {
+    if (this.timer || this.ended) return;
+    // Out of credit: the next 'ack' reschedules.
+    if (this.credit <= 0 && this.next < this.log.end) return;
+    const ready = this.pendingBytes() >= this.maxBytes || this.log.done;
+    this.timer = setTimeout(() => {
+      this.timer = null;
+      this.pump();
+    }, ready ? 0 : FRAME_INTERVAL_MS);
+  }
+
+  pendingBytes() {
+    let bytes = 0;
+    for (let i = Math.max(this.next, this.log.start); i < this.log.end && bytes < this.maxBytes; i++) {
+      bytes += this.log.line(i).length + 1;
+    }
+    return bytes;
+  }
+
+  pump() {
+    const { log } = this;
+    // Lines dropped before this session got to them are skipped.
+    this.next = Math.max(this.next, log.start);
+    while (this.credit > 0 && this.next < log.end) {
+      const first = this.next;
+      const lines = [];
+      let bytes = 0;
+      let end = first;
+      while (end < log.end && (end === first || bytes + log.line(end).length < this.maxBytes)) {
+        lines.push(log.line(end));
+        bytes += log.line(end).length + 1;
+        end++;
+      }
+      const payload = Buffer.from(lines.join('\n'));
+      this.socket.emit('steps', { first, count: end - first }, payload);
+      this.next = end;
+      this.credit--;
+    }
+    if (log.done && this.next >= log.end && !this.ended) {
+      this.ended = true;
+      this.socket.emit('end', { total: log.end, ...(log.error && { error: log.error }) });
+    }
+  }
+
+  ack() {
+    // Extra or repeated acks cannot raise the credit above the window.
+    this.credit = Math.min(this.window, this.credit + 1);
+    this.schedule();
+  }
+
+  resize(window) {
+    this.credit += window - this.window;
+    this.window = window;
+    this.schedule();
+  }
+
+  close() {
+    clearTimeout(this.timer);
+    this.ended = true;
+    this.log.off('lines', this.onLines);
+  }
+}
+
+// Serves trace sessions on `httpServer`; currentLog() returns the TraceLog
+// of the latest run, or null before the first one.
+function attachTraceSocket(httpServer, currentLog) {
+  const io = new Server(httpServer, {
+    cors: { origin: '*' },
+    perMessageDeflate: { threshold: 1024 },
+  });
+
+  io.on('connection', (socket) => {
+    let session = null;
+
+    socket.on('subscribe', (options = {}) => {
+      session?.close();
+      session = null;
+      const log = currentLog();
+      if (!log) return socket.emit('end', { total: 0, error: 'No run started' });
+
+      const resume = options.run === log.id;
+      session = new Session(socket, log, {
+        from: resume ? clamp(options.from, log.start, log.end, log.start) : log.start,
+        window: clamp(options.window, 1, MAX_WINDOW, DEFAULT_WINDOW),
+        maxBytes: clamp(options.maxBytes, 1024, MAX_FRAME_BYTES, DEFAULT_FRAME_BYTES),
+      });
+    });
+    socket.on('ack', () => session?.ack());
+    socket.on('window', (n) => session?.resize(clamp(n, 1, MAX_WINDOW, session.window)));
+    socket.on('disconnect', () => session?.close());
+  });
+  return io;
+}
+
+module.exports = { TraceLog, attachTraceSocket };
@@ -27,10 +27,10 @@ function VisualizerRouter() {
   if (['dijkstra', 'prims', 'kruskal'].includes(algorithm)) {
     return <GreedyVisualizer algorithm={algorithm} />;
   }
-  if (['dp-knapsack', 'dp-fibonacci'].includes(algorithm)) {
+  if (['dp-knapsack', 'dp-fibonacci', 'dp-edit-distance', 'dp-lcs', 'dp-smith-waterman'].includes(algorithm)) {
     return <DPVisualizer algorithm={algorithm} />;
   }
-  if (['string-kmp', 'string-rabin'].includes(algorithm)) {
+  if (['string-kmp', 'string-rabin', 'string-suffix-array'].includes(algorithm)) {
     return <StringAlgoVisualizer algorithm={algorithm} />;
   }
 
@@ -1,6 +1,11 @@
 import { useState, useEffect, useRef } from 'react';
 import { motion, AnimatePresence } from 'framer-motion';
 import PseudocodePanel from './PseudocodePanel'; 
+import { loadMessages, withText } from '../messages';
+
+// The backend runs N-Queens in step mode: it only computes steps as we ask
+// for them, STEP_BATCH at a time, keeping about that many buffered ahead.
+const STEP_BATCH = 50;
 
 export default function BacktrackingVisualizer() {
     const [steps, setSteps] = useState([]);
@@ -11,8 +16,10 @@ export default function BacktrackingVisualizer() {
     const [finalBoard, setFinalBoard] = useState(null);
     const [showHistory, setShowHistory] = useState(false);
     const [pseudocode, setPseudocode] = useState([]); 
+    const [stepMode, setStepMode] = useState(false);
     const eventSourceRef = useRef(null);
     const animationRef = useRef(null);
+    const requestedRef = useRef(0);
 
     useEffect(() => {
         const fetchPseudocode = async () => {
@@ -34,31 +41,59 @@ export default function BacktrackingVisualizer() {
             animationRef.current = setTimeout(() => {
                 setCurrentStepIndex((prev) => {
                     const next = prev + 1;
-                    if (next === steps.length - 1) {
+                    if (next === steps.length - 1 && !stepMode) {
                         setTimeout(() => setShowHistory(true), speed + 50);
                     }
                     return next;
                 });
             }, speed);
-        } else if (currentStepIndex >= steps.length - 1) {
+        } else if (currentStepIndex >= steps.length - 1 && !stepMode) {
+            // In step mode an exhausted buffer just means more steps are on the way.
             setIsPlaying(false);
+            if (steps.length > 0) setShowHistory(true);
         }
         return () => clearTimeout(animationRef.current);
-    }, [isPlaying, currentStepIndex, steps, speed]);
+    }, [isPlaying, currentStepIndex, steps, speed, stepMode]);
+
+    const requestSteps = (count) => {
+        requestedRef.current += count;
+        fetch('http://localhost:5000/next', {
+            method: 'POST',
+            headers: { 'Content-Type': 'application/json' },
+            body: JSON.stringify({ count }),
+        });
+    };
+
+    // Top up the step buffer whenever playback gets close to its end.
+    useEffect(() => {
+        if (!stepMode) return;
+        if (requestedRef.current - currentStepIndex <= STEP_BATCH / 2) {
+            requestSteps(STEP_BATCH);
+        }
+    }, [stepMode, currentStepIndex]);
 
     const handleRun = async () => {
         reset();
-        await fetch('http://localhost:5000/run-n-queen', {
+        const res = await fetch('http://localhost:5000/run-n-queen', {
             method: 'POST',
             headers: { 'Content-Type': 'application/json' },
-            body: JSON.stringify({ array: [size] }),
+            body: JSON.stringify({ array: [size], stepMode: true }),
         });
+        const { stepMode: stepping } = await res.json();
+        const messages = await loadMessages();
 
         const eventSource = new EventSource('http://localhost:5000/stream');
         eventSourceRef.current = eventSource;
+        if (stepping) {
+            eventSource.onopen = () => {
+                eventSource.onopen = null;
+                setStepMode(true);
+                setIsPlaying(true);
+            };
+        }
 
         eventSource.onmessage = (event) => {
-            const data = JSON.parse(event.data);
+            const data = withText(messages, JSON.parse(event.data));
             setSteps((prev) => [...prev, data]);
             if (data.message?.includes("Solution found")) {
                 setFinalBoard(data.board);
@@ -67,6 +102,7 @@ export default function BacktrackingVisualizer() {
 
         eventSource.addEventListener('end', () => {
             eventSource.close();
+            setStepMode(false);
             setIsPlaying(true);
         });
     };
@@ -77,6 +113,8 @@ export default function BacktrackingVisualizer() {
         setFinalBoard(null);
         setIsPlaying(false);
         setShowHistory(false);
+        setStepMode(false);
+        requestedRef.current = 0;
         if (eventSourceRef.current) eventSourceRef.current.close();
         clearTimeout(animationRef.current);
     };
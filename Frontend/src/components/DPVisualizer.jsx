@@ -1,29 +1,41 @@
-import { useEffect, useState, useRef } from 'react';
+import { useEffect, useState } from 'react';
 import PseudocodePanel from './PseudocodePanel';
 import { motion, AnimatePresence } from 'framer-motion';
+import { VirtualGrid } from './VirtualList';
+import IncrementalNote from './IncrementalNote';
+import { useTrace } from '../useTrace';
+import { sessionId } from '../session';
+
+// Sequence alignments share one binary and the knapsack-style dpRow steps.
+const ALIGNMENTS = ['dp-edit-distance', 'dp-lcs', 'dp-smith-waterman'];
+// Tables with more cells than this are drawn as a scrollable window.
+const LARGE_TABLE = 400;
 
 export default function DPVisualizerAnimated({ algorithm }) {
-  const [dpMatrix, setDpMatrix] = useState([]);
-  const [currentStep, setCurrentStep] = useState(null);
-  const [stepQueue, setStepQueue] = useState([]);
+  // The trace worker folds the steps into the table; we only hold the table
+  // as of the step being shown.
+  const trace = useTrace('dp');
+  const { seek, stop } = trace;
+  const [index, setIndex] = useState(-1);
   const [speed, setSpeed] = useState(500);
   const [runId, setRunId] = useState(0);
-  const eventRef = useRef(null);
   const [pseudocode, setPseudocode] = useState([]);
   const [fibInput, setFibInput] = useState('');
   const [cap, setCap] = useState('');
   const [weights, setWeights] = useState('');
   const [values, setValues] = useState('');
+  const [seqA, setSeqA] = useState('');
+  const [seqB, setSeqB] = useState('');
+  const isAlignment = ALIGNMENTS.includes(algorithm);
+  const dpMatrix = trace.current?.state ?? [];
+  const currentStep = trace.current?.step ?? null;
+  const result = trace.meta.find(m => 'finalValue' in m) ?? null;
+  const incremental = trace.meta.find(m => m.type === 'incremental');
   const currentLine = currentStep?.line ?? null;
 
   const reset = () => {
-    setDpMatrix([]);
-    setCurrentStep(null);
-    setStepQueue([]);
-    if (eventRef.current) {
-      eventRef.current.close();
-      eventRef.current = null;
-    }
+    stop();
+    setIndex(-1);
   };
 
   const handleStart = () => {
@@ -63,6 +75,8 @@ export default function DPVisualizerAnimated({ algorithm }) {
           params = [parsed];
         }
       }
+    } else if (isAlignment) {
+      if (seqA && seqB) params = [seqA, seqB];
     } else {
       if (cap && weights && values) {
         try {
@@ -78,65 +92,45 @@ export default function DPVisualizerAnimated({ algorithm }) {
       }
     }
 
-    // Send POST only if params exist, otherwise let backend use defaults
+    // Send POST only if params exist, otherwise let backend use defaults.
+    // The trace is subscribed to once the server has started the run.
+    let live = true;
     fetch(`http://localhost:5000/run-${algorithm}`, {
       method: 'POST',
       headers: { 'Content-Type': 'application/json' },
-      body: JSON.stringify(params ? { array: params } : {})
-    });
-
-    const es = new EventSource('http://localhost:5000/stream');
-    eventRef.current = es;
-
-    es.onmessage = e => {
-      const data = e.data.trim();
-      if (!data.startsWith('{')) return;
-      let obj;
-      try {
-        obj = JSON.parse(data);
-      } catch {
-        return;
-      }
-
-      if (algorithm === 'dp-fibonacci' && obj.message === 'Fibonacci complete') return;
-      if (algorithm === 'dp-knapsack' && !('dpRow' in obj)) return;
-      if (algorithm === 'dp-fibonacci' && !('result' in obj)) return;
-
-      setStepQueue(q => [...q, obj]);
-    };
-
-    es.addEventListener('end', () => es.close());
+      body: JSON.stringify(params ? { array: params, session: sessionId } : { session: sessionId })
+    }).then(() => live && trace.start({ algorithm }));
 
-    return () => es.close();
+    return () => { live = false; };
   }, [runId, algorithm]);
 
+  // Shows each step for `speed` ms, following the trace as it arrives.
   useEffect(() => {
-    if (!currentStep && stepQueue.length) {
-      const [step, ...rest] = stepQueue;
-      setStepQueue(rest);
+    if (runId === 0 || index >= trace.total - 1) return;
+    const timer = setTimeout(() => setIndex(i => i + 1), index < 0 ? 0 : speed);
+    return () => clearTimeout(timer);
+  }, [runId, index, trace.total, speed]);
 
-      if (algorithm === 'dp-fibonacci') {
-        setDpMatrix(prev => {
-          const row = prev[0] ? [...prev[0]] : [];
-          row.push(step.result);
-          return [row];
-        });
-      } else {
-        setDpMatrix(prev => {
-          const rows = Math.max(prev.length, step.step + 1);
-          const cols = step.dpRow.length;
-          const m = Array.from({ length: rows }, (_, i) =>
-            i < prev.length ? [...prev[i]] : Array(cols).fill(0)
-          );
-          m[step.step] = step.dpRow;
-          return m;
-        });
-      }
+  useEffect(() => {
+    if (index >= 0) seek(index);
+  }, [index, seek]);
 
-      setCurrentStep(step);
-      setTimeout(() => setCurrentStep(null), speed);
+  const cellColor = (i, j) => {
+    let bg = '#fff';
+    if (algorithm === 'dp-fibonacci' && currentStep && 'prevIndices' in currentStep) {
+      const dpLen = dpMatrix[0]?.length || 0;
+      if (currentStep.prevIndices.includes(j)) bg = '#facc15';
+      else if (j === dpLen - 1) bg = '#ef4444';
     }
-  }, [stepQueue, currentStep, speed, algorithm]);
+    if (algorithm === 'dp-knapsack' && currentStep?.step === i && currentStep.weight === j) {
+      bg = currentStep.decision === 'include' ? '#bbf7d0' : '#fecaca';
+    }
+    if (isAlignment && currentStep?.step === i && currentStep.weight === j) {
+      bg = currentStep.decision === 'match' ? '#bbf7d0' : '#fecaca';
+    }
+    return bg;
+  };
+  const cols = dpMatrix.reduce((n, row) => Math.max(n, row.length), 0);
 
   const display = algorithm.replace('dp-', '');
 
@@ -159,6 +153,24 @@ export default function DPVisualizerAnimated({ algorithm }) {
               />
             </div>
           )}
+          {isAlignment && (
+            <>
+              <label>a:</label>
+              <input
+                value={seqA}
+                onChange={e => setSeqA(e.target.value)}
+                placeholder="kitten"
+                className="border ml-2 p-1 w-40"
+              />
+              <label className="ml-4">b:</label>
+              <input
+                value={seqB}
+                onChange={e => setSeqB(e.target.value)}
+                placeholder="sitting"
+                className="border ml-2 p-1 w-40"
+              />
+            </>
+          )}
           {algorithm === 'dp-knapsack' && (
             <>
               <label>cap:</label>
@@ -202,32 +214,48 @@ export default function DPVisualizerAnimated({ algorithm }) {
         </div>
 
         {/* DP Table */}
-        {runId > 0 && (
+        {runId > 0 && dpMatrix.length * cols <= LARGE_TABLE && (
           <table className="table-auto border-collapse mb-2">
             <tbody>
               {dpMatrix.map((row, i) => (
                 <tr key={i}>
-                  {row.map((v, j) => {
-                    let bg = '#fff';
-                    if (algorithm === 'dp-fibonacci' && currentStep && 'prevIndices' in currentStep) {
-                      const dpLen = dpMatrix[0]?.length || 0;
-                      if (currentStep.prevIndices.includes(j)) bg = '#facc15';
-                      else if (j === dpLen - 1) bg = '#ef4444';
-                    }
-                    if (algorithm === 'dp-knapsack' && currentStep?.step === i && currentStep.weight === j) {
-                      bg = currentStep.decision === 'include' ? '#bbf7d0' : '#fecaca';
-                    }
-                    return (
-                      <motion.td key={j} className="border p-2 text-center" animate={{ backgroundColor: bg }} transition={{ duration: 0.5 }}>
-                        {v}
-                      </motion.td>
-                    );
-                  })}
+                  {row.map((v, j) => (
+                    <motion.td key={j} className="border p-2 text-center" animate={{ backgroundColor: cellColor(i, j) }} transition={{ duration: 0.5 }}>
+                      {v}
+                    </motion.td>
+                  ))}
                 </tr>
               ))}
             </tbody>
           </table>
         )}
+        {runId > 0 && dpMatrix.length * cols > LARGE_TABLE && (
+          <div className="mb-2">
+            <VirtualGrid
+              rows={dpMatrix.length}
+              cols={cols}
+              cellWidth={56}
+              cellHeight={36}
+              width={720}
+              height={420}
+              renderCell={(i, j) => (
+                <div className="border h-full text-center leading-9 truncate" style={{ backgroundColor: cellColor(i, j) }}>
+                  {dpMatrix[i][j]}
+                </div>
+              )}
+            />
+          </div>
+        )}
+
+        {/* Large inputs are scored without a trace; only the result comes back */}
+        {result && (
+          <div className="mb-2">
+            Result: {result.finalValue}
+            {result.kernel && ` (${result.kernel} kernel, ${result.cells} cells in ${result.ms} ms)`}
+          </div>
+        )}
+
+        <IncrementalNote report={incremental} />
 
         {/* Step Info */}
         <AnimatePresence>
@@ -244,6 +272,8 @@ export default function DPVisualizerAnimated({ algorithm }) {
                 ? currentStep.prevIndices
                   ? `Sum indices ${currentStep.prevIndices[0]} + ${currentStep.prevIndices[1]} = ${currentStep.result}`
                   : currentStep.message
+                : isAlignment
+                ? `Cell (${currentStep.step}, ${currentStep.weight}): ${currentStep.decision}, val=${currentStep.currentValue}`
                 : `Step ${currentStep.step}: W=${currentStep.weight}, ${currentStep.decision}, val=${currentStep.currentValue}`
               }
             </motion.div>
@@ -2,12 +2,21 @@ import React, { useState, useEffect, useRef } from 'react';
 import Graph from './Graphs/Graph';
 import Control from './Graphs/Control';
 import PseudocodePanel from './PseudocodePanel';
+import { VirtualList } from './VirtualList';
+import IncrementalNote from './IncrementalNote';
+import { useTrace } from '../useTrace';
+import { sessionId } from '../session';
 
 const WIDTH = 600, HEIGHT = 400;
 
 export default function GreedyVisualizer({ algorithm }) {
   const [graph, setGraph] = useState({ nodes: [], edges: [] });
-  const [steps, setSteps] = useState([]);
+  // Steps are decoded and buffered by the trace worker; init and final
+  // lines come back as trace.meta.
+  const trace = useTrace('greedy');
+  const { seek } = trace;
+  const total = trace.total;
+  const shownStep = trace.current?.step;
   const [currentStep, setCurrentStep] = useState(0);
   const [isPlaying, setIsPlaying] = useState(false);
   const [isRunning, setIsRunning] = useState(false);
@@ -16,11 +25,15 @@ export default function GreedyVisualizer({ algorithm }) {
   const [finalEdges, setFinalEdges] = useState([]);
   const [totalCost, setTotalCost] = useState(0);
   const [userInput, setUserInput] = useState('');
+  const [source, setSource] = useState('0');
+  const [target, setTarget] = useState('3');
+  const [bidirectional, setBidirectional] = useState(false);
   const [nodePositions, setNodePositions] = useState({});
   const [explanation, setExplanation] = useState('');
+  const [incremental, setIncremental] = useState(null);
   const [pseudocode, setPseudocode] = useState([]);
   const intervalRef = useRef(null);
-  const currentLine = currentStep?.line ?? null;
+  const currentLine = shownStep?.line ?? null;
 
   function calculateNodePositions(nodes) {
     const positions = {};
@@ -54,10 +67,10 @@ export default function GreedyVisualizer({ algorithm }) {
 
 
   useEffect(() => {
-    if (isPlaying && currentStep < steps.length - 1) {
+    if (isPlaying && currentStep < total - 1) {
       intervalRef.current = setInterval(() => {
         setCurrentStep(s => {
-          if (s < steps.length - 1) return s + 1;
+          if (s < total - 1) return s + 1;
           clearInterval(intervalRef.current);
           setIsPlaying(false);
           return s;
@@ -65,64 +78,84 @@ export default function GreedyVisualizer({ algorithm }) {
       }, speed);
     }
     return () => clearInterval(intervalRef.current);
-  }, [isPlaying, currentStep, steps, speed]);
+  }, [isPlaying, currentStep, total, speed]);
+
+  const available = currentStep < total;
+  useEffect(() => {
+    if (available) seek(currentStep);
+  }, [currentStep, available, seek]);
+
+  // Playback starts with the first step.
+  const started = total > 0;
+  useEffect(() => {
+    if (started) { setIsPlaying(true); setCurrentStep(0); }
+  }, [started]);
+
+  // Run-wide lines: the graph, the final answer, the end of the run.
+  const metaSeen = useRef(0);
+  useEffect(() => {
+    if (trace.meta.length < metaSeen.current) metaSeen.current = 0;
+    for (const d of trace.meta.slice(metaSeen.current)) {
+      switch (d.type) {
+        case 'init':
+          setGraph({ nodes: d.nodes, edges: d.edges });
+          setNodePositions(calculateNodePositions(d.nodes));
+          break;
+        case 'final':
+          if (d.path) {
+            setFinalPath(d.path.split('->').map(Number));
+            setTotalCost(d.cost);
+            setExplanation(d.explanation);
+          } else if (d.mst) {
+            const esArr = (d.mst.match(/\((\d+)-(\d+)\)/g) || [])
+              .map(p => { const [_, f, t] = p.match(/\((\d+)-(\d+)\)/); return { from: +f, to: +t }; });
+            setFinalEdges(esArr);
+            setTotalCost(d.cost);
+            setExplanation(d.explanation);
+          }
+          break;
+        case 'incremental':
+          setIncremental(d);
+          break;
+        case 'end':
+        case 'error':
+          setIsRunning(false);
+          break;
+      }
+    }
+    metaSeen.current = trace.meta.length;
+  }, [trace.meta]);
+
+  useEffect(() => {
+    if (trace.done || trace.error) setIsRunning(false);
+  }, [trace.done, trace.error]);
 
   const handleStart = () => {
     // reset
     setIsPlaying(false);
     clearInterval(intervalRef.current);
     setCurrentStep(0);
-    setSteps([]);
+    trace.stop();
     setFinalPath([]);
     setFinalEdges([]);
     setTotalCost(0);
     setExplanation('');
+    setIncremental(null);
     setIsRunning(true);
 
     const arr = userInput.trim().split(/\s+/).map(Number).filter(n => !isNaN(n));
     const body = arr.length ? { array: arr } : {};
+    if (algorithm === 'dijkstra') {
+      if (source.trim() !== '') body.source = Number(source);
+      if (target.trim() !== '') body.target = Number(target);
+      body.bidirectional = bidirectional;
+      body.session = sessionId;
+    }
     fetch(`http://localhost:5000/run-greedy-${algorithm}`, {
       method: 'POST', headers: { 'Content-Type': 'application/json' }, body: JSON.stringify(body)
     }).then(r => {
       if (!r.ok) throw new Error();
-      const es = new EventSource('http://localhost:5000/stream');
-
-      es.onmessage = e => {
-        const d = JSON.parse(e.data);
-        switch (d.type) {
-          case 'init':
-            setGraph({ nodes: d.nodes, edges: d.edges });
-            setNodePositions(calculateNodePositions(d.nodes));
-            break;
-          case 'visit':
-          case 'update':
-          case 'include':
-            setSteps(prev => {
-              if (prev.length === 0) { setIsPlaying(true); setCurrentStep(0); }
-              return [...prev, d];
-            });
-            break;
-          case 'final':
-            if (d.path) {
-              setFinalPath(d.path.split('->').map(Number));
-              setTotalCost(d.cost);
-              setExplanation(d.explanation);
-            } else if (d.mst) {
-              const esArr = (d.mst.match(/\((\d+)-(\d+)\)/g) || [])
-                .map(p => { const [_, f, t] = p.match(/\((\d+)-(\d+)\)/); return { from: +f, to: +t }; });
-              setFinalEdges(esArr);
-              setTotalCost(d.cost);
-              setExplanation(d.explanation);
-            }
-            break;
-          case 'end':
-          case 'error':
-            es.close();
-            setIsRunning(false);
-            break;
-        }
-      };
-      es.onerror = () => { es.close(); setIsRunning(false); };
+      trace.start();
     })
       .catch(() => { alert('Error'); setIsRunning(false); });
   };
@@ -131,7 +164,7 @@ export default function GreedyVisualizer({ algorithm }) {
   const handleReset = () => { setIsPlaying(false); clearInterval(intervalRef.current); setCurrentStep(0); };
   const handleLast = () => {
     setIsPlaying(false); clearInterval(intervalRef.current);
-    if (steps.length) setCurrentStep(steps.length - 1);
+    if (total) setCurrentStep(total - 1);
   };
 
   const isEdgeHighlighted = (f, t) => {
@@ -145,7 +178,7 @@ export default function GreedyVisualizer({ algorithm }) {
     return false;
   };
 
-  const isNodeActive = n => steps[currentStep]?.node === n;
+  const isNodeActive = n => shownStep?.node === n;
   const isNodeInFinalSolution = n =>
     (algorithm === 'dijkstra' && finalPath.includes(n)) ||
     (algorithm === 'prims' && finalEdges.some(e => e.from === n || e.to === n));
@@ -154,7 +187,16 @@ export default function GreedyVisualizer({ algorithm }) {
     <div className="p-5 bg-gray-50 min-h-screen">
       <h1 className="text-2xl font-bold mb-4">{algorithm.toUpperCase()} VISUALIZER</h1>
       <div className="flex-row">
-
+        {algorithm === 'dijkstra' && (
+          <div className="flex items-center gap-3 mb-3">
+            <label>Source <input type="number" className="border rounded px-2 py-1 w-20" value={source} onChange={e => setSource(e.target.value)} /></label>
+            <label>Target <input type="number" className="border rounded px-2 py-1 w-20" value={target} onChange={e => setTarget(e.target.value)} /></label>
+            <label className="flex items-center gap-1">
+              <input type="checkbox" checked={bidirectional} onChange={e => setBidirectional(e.target.checked)} />
+              Bidirectional
+            </label>
+          </div>
+        )}
 
         <Control
           userInput={userInput}
@@ -165,7 +207,7 @@ export default function GreedyVisualizer({ algorithm }) {
           onLast={handleLast}
           isRunning={isRunning}
           isPlaying={isPlaying}
-          stepsLength={steps.length}
+          stepsLength={total}
           currentStep={currentStep}
           speed={speed}
           setSpeed={setSpeed}
@@ -183,10 +225,10 @@ export default function GreedyVisualizer({ algorithm }) {
             isNodeInFinalSolution={isNodeInFinalSolution}
           />
 
-          {steps.length > 0 && currentStep < steps.length && (
+          {shownStep && (
             <div className="mt-4 p-3 bg-blue-50 border border-blue-200 rounded-lg">
               <h3 className="font-semibold text-blue-800">Current Action:</h3>
-              <p>{steps[currentStep].explanation}</p>
+              <p>{shownStep.explanation}</p>
             </div>
           )}
 
@@ -209,6 +251,7 @@ export default function GreedyVisualizer({ algorithm }) {
                 </>
               )}
               <p className="italic mt-2 text-sm">{explanation}</p>
+              <IncrementalNote report={incremental} />
             </div>
           )}
         </div>
@@ -230,20 +273,25 @@ export default function GreedyVisualizer({ algorithm }) {
           <PseudocodePanel pseudocodeLines={pseudocode} currentLine={currentLine} />
 
 
-          <div className="bg-white rounded-lg shadow p-4 max-h-64 overflow-y-auto">
+          <div className="bg-white rounded-lg shadow p-4">
             <span className="text-sm font-medium flex justify-between items-center mb-2">
               <h3 className="font-bold text-lg mb-2">Algorithm Steps</h3>
-              {steps.length > 0 ? `${currentStep + 1}/${steps.length}` : '0/0'}
+              {total > 0 ? `${currentStep + 1}/${total}` : '0/0'}
 
             </span>
-            {steps.length > 0 ? (
-              <ul className="space-y-1">
-                {steps.slice(0, currentStep + 1).map((s, i) => (
-                  <li key={i} className={`p-1 rounded ${i === currentStep ? 'bg-yellow-100' : ''}`}>
+            {total > 0 ? (
+              <VirtualList
+                count={Math.min(currentStep + 1, total)}
+                itemSize={32}
+                size={192}
+                load={trace.rows}
+                scrollTo={currentStep}
+                renderItem={(s, i) => (
+                  <div className={`p-1 rounded truncate ${i === currentStep ? 'bg-yellow-100' : ''}`}>
                     <span className="text-gray-500 text-xs">{i + 1}.</span> {s.explanation}
-                  </li>
-                ))}
-              </ul>
+                  </div>
+                )}
+              />
             ) : (
               <p className="text-gray-500">No steps yet. Click Start.</p>
             )}
@@ -0,0 +1,11 @@
+// The work a session re-run did against a full run, from the binary's
+// {"type":"incremental"} line.
+export default function IncrementalNote({ report }) {
+  if (!report) return null;
+  const share = report.fullWork ? Math.round((100 * report.work) / report.fullWork) : 100;
+  return (
+    <div className="mb-2 text-sm text-gray-600">
+      Recomputed {report.work} of {report.fullWork} {report.unit} ({share}%); {report.saved} reused from the last run
+    </div>
+  );
+}
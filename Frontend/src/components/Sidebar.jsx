@@ -15,10 +15,16 @@ export default function Sidebar() {
       { name: "Bubble Sort", value: "bubble-sort" },
       { name: "Selection Sort", value: "selection-sort" },
       { name: "Insertion Sort", value: "insertion-sort" },
+      { name: "MSD Radix Sort (strings)", value: "msd-radix-sort" },
+      { name: "Multikey Quicksort (strings)", value: "multikey-quicksort" },
+      { name: "LCP Merge Sort (strings)", value: "lcp-merge-sort" },
     ],
     "Dynamic Programming": [
       { name: "Knapsack", value: "dp-knapsack" },
       { name: "Fibonacci", value: "dp-fibonacci" },
+      { name: "Edit Distance", value: "dp-edit-distance" },
+      { name: "Longest Common Subsequence", value: "dp-lcs" },
+      { name: "Smith-Waterman", value: "dp-smith-waterman" },
     ],
     "Backtracking": [
       { name: "N-Queen", value: "nqueen" },
@@ -32,6 +38,7 @@ export default function Sidebar() {
     "String Algorithms": [
       { name: "KMP", value: "string-kmp" },
       { name: "Rabin-Karp", value: "string-rabin" },
+      { name: "Suffix Array", value: "string-suffix-array" },
     ],
   };
 
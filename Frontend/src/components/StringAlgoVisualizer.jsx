@@ -1,23 +1,48 @@
 import { useEffect, useState, useRef } from 'react';
 import PseudocodePanel from './PseudocodePanel';
 import { motion } from 'framer-motion';
+import { VirtualList } from './VirtualList';
+import IncrementalNote from './IncrementalNote';
+import { useTrace } from '../useTrace';
+import { sessionId } from '../session';
+
+// Rows longer than this (text, pattern, arrays) are drawn as a scrollable window.
+const LARGE_ROW = 64;
 
 export default function StringAlgoVisualizer({ algorithm }) {
-  const [output, setOutput] = useState([]);
-  const [steps, setSteps] = useState([]);
+  // Steps are decoded and buffered by the trace worker; lines carrying the
+  // text or pattern come back as trace.meta.
+  const trace = useTrace('string');
+  const { seek, stop } = trace;
+  const total = trace.total;
   const [currentStep, setCurrentStep] = useState(0);
   const [inputText, setInputText] = useState('');
   const [inputPattern, setInputPattern] = useState('');
-  const [text, setText] = useState('');
-  const [pattern, setPattern] = useState('');
   const [pseudocode, setPseudocode] = useState([]);
   const [isPlaying, setIsPlaying] = useState(false);
   const [isStarted, setIsStarted] = useState(false);
   const [speed, setSpeed] = useState(1000);
   const intervalRef = useRef(null);
-  const eventSourceRef = useRef(null);
-  const currentLine = currentStep?.line ?? null;
-  const endpoint = algorithm === 'string-kmp' ? 'kmp' : 'rabin';
+  const text = trace.meta.findLast(m => typeof m.text === 'string')?.text ?? '';
+  const pattern = trace.meta.findLast(m => typeof m.pattern === 'string')?.pattern ?? '';
+  const incremental = trace.meta.find(m => m.type === 'incremental');
+  const endpoint = algorithm.replace(/^string-/, '');
+  const titles = {
+    'string-kmp': 'KMP String Matching Algorithm Visualizer',
+    'string-rabin': 'Rabin-Karp String Matching Algorithm Visualizer',
+    'string-suffix-array': 'Suffix Array Index Visualizer',
+  };
+  // Suffix-array steps carry the array they produced, named by stage.
+  const arrayTitles = {
+    lms: 'LMS Positions',
+    induce: 'Suffix Array (induced LMS order)',
+    reduce: 'Reduced String',
+    sorted: 'Suffix Array',
+    'suffix-array': 'Suffix Array',
+    lcp: 'LCP Array',
+    'lcp-array': 'LCP Array',
+    found: 'Match Positions',
+  };
 
   // Reset everything when algorithm changes
   useEffect(() => {
@@ -51,50 +76,19 @@ export default function StringAlgoVisualizer({ algorithm }) {
   };
 
   const fetchSteps = (textVal, patternVal) => {
-    if (eventSourceRef.current) {
-      eventSourceRef.current.close();
-    }
-
     const body = textVal || patternVal 
-      ? { array: [textVal, patternVal] }
-      : {};
+      ? { array: [textVal, patternVal], session: sessionId }
+      : { session: sessionId };
 
     fetch(`http://localhost:5000/run-string-${endpoint}`, {
       method: 'POST',
       headers: { 'Content-Type': 'application/json' },
       body: JSON.stringify(body),
-    });
-
-    const eventSource = new EventSource('http://localhost:5000/stream');
-    eventSourceRef.current = eventSource;
-
-    eventSource.onmessage = (e) => {
-      try {
-        const json = JSON.parse(e.data);
-        
-        // Process first step to set text and pattern separately
-        if (json.text && typeof json.text === 'string') {
-          setText(json.text);
-        }
-        if (json.pattern && typeof json.pattern === 'string') {
-          setPattern(json.pattern);
-        }
-        
-        setSteps(prev => [...prev, json]);
-      } catch (error) {
-        setOutput(prev => [...prev, e.data]);
-      }
-    };
-
-    eventSource.addEventListener('end', () => {
-      eventSource.close();
-      eventSourceRef.current = null;
-      setCurrentStep(0);
-    });
+    }).then(() => trace.start());
   };
 
   useEffect(() => {
-    if (isPlaying && steps.length > 0 && currentStep < steps.length - 1) {
+    if (isPlaying && total > 0 && currentStep < total - 1) {
       intervalRef.current = setInterval(() => {
         setCurrentStep(prev => prev + 1);
       }, speed);
@@ -102,24 +96,46 @@ export default function StringAlgoVisualizer({ algorithm }) {
       clearInterval(intervalRef.current);
     }
     return () => clearInterval(intervalRef.current);
-  }, [isPlaying, currentStep, speed, steps]);
+  }, [isPlaying, currentStep, speed, total]);
+
+  const available = currentStep < total;
+  useEffect(() => {
+    if (available) seek(currentStep);
+  }, [currentStep, available, seek]);
+
+  // Replay from the start once the whole trace is in.
+  useEffect(() => {
+    if (trace.done) setCurrentStep(0);
+  }, [trace.done]);
 
   const reset = () => {
     clearInterval(intervalRef.current);
-    if (eventSourceRef.current) {
-      eventSourceRef.current.close();
-      eventSourceRef.current = null;
-    }
+    stop();
     setIsStarted(false);
     setIsPlaying(false);
     setCurrentStep(0);
-    setSteps([]);
-    setText('');
-    setPattern('');
-    setOutput([]);
   };
 
-  const step = steps[currentStep] || {};
+  const step = trace.current?.step || {};
+  const currentLine = step.line ?? null;
+
+  const cellRow = (values, render, highlightIndex) =>
+    values.length > LARGE_ROW ? (
+      <VirtualList
+        horizontal
+        count={values.length}
+        itemSize={36}
+        size={720}
+        crossSize={64}
+        items={values}
+        scrollTo={highlightIndex}
+        renderItem={render}
+      />
+    ) : (
+      <div className="flex space-x-1 overflow-x-auto pb-2">
+        {Array.from(values, render)}
+      </div>
+    );
 
   const renderCharacter = (char, idx, highlightIndex, isPattern = false) => {
     const isHighlighted = idx === highlightIndex;
@@ -171,9 +187,7 @@ export default function StringAlgoVisualizer({ algorithm }) {
         {/* Header */}
         <div className="flex justify-between items-center">
           <h2 className="text-2xl font-bold text-gray-800">
-            {algorithm === 'string-kmp'
-              ? 'KMP String Matching Algorithm Visualizer'
-              : 'Rabin-Karp String Matching Algorithm Visualizer'}
+            {titles[algorithm]}
           </h2>
           {isStarted && (
             <button
@@ -252,9 +266,9 @@ export default function StringAlgoVisualizer({ algorithm }) {
               </button>
               <button
                 onClick={() =>
-                  setCurrentStep(s => Math.min(s + 1, steps.length - 1))
+                  setCurrentStep(s => Math.min(s + 1, total - 1))
                 }
-                disabled={currentStep === steps.length - 1}
+                disabled={currentStep === total - 1}
                 className="px-3 py-2 bg-gray-500 text-white rounded disabled:opacity-50"
               >
                 Next
@@ -264,13 +278,14 @@ export default function StringAlgoVisualizer({ algorithm }) {
             {/* Progress & Message */}
             <div className="bg-gray-100 p-4 rounded mb-4">
               <div className="text-gray-600 mb-2">
-                Step {currentStep + 1} of {steps.length}
+                Step {currentStep + 1} of {total}
               </div>
               {step.message && (
                 <div className="bg-green-50 border border-green-200 text-green-700 p-2 rounded text-sm font-mono">
                   {step.message}
                 </div>
               )}
+              <IncrementalNote report={incremental} />
             </div>
 
             {/* Visualization */}
@@ -278,30 +293,25 @@ export default function StringAlgoVisualizer({ algorithm }) {
               {step.lps && (
                 <div>
                   <h3 className="text-gray-800 font-medium mb-2">LPS Array</h3>
-                  <div className="flex space-x-1 overflow-x-auto pb-2">
-                    {step.lps.map((num, idx) =>
-                      renderNumberCell(num, idx, step.l)
-                    )}
-                  </div>
+                  {cellRow(step.lps, (num, idx) => renderNumberCell(num, idx, step.l), step.l)}
+                </div>
+              )}
+
+              {step.array && (
+                <div>
+                  <h3 className="text-gray-800 font-medium mb-2">{arrayTitles[step.stage] || 'Array'}</h3>
+                  {cellRow(step.array, (num, idx) => renderNumberCell(num, idx, -1))}
                 </div>
               )}
 
               <div>
                 <h3 className="text-gray-800 font-medium mb-2">Pattern</h3>
-                <div className="flex space-x-1 overflow-x-auto pb-2">
-                  {pattern && pattern.split('').map((char, idx) =>
-                    renderCharacter(char, idx, step.r, true)
-                  )}
-                </div>
+                {cellRow(pattern, (char, idx) => renderCharacter(char, idx, step.r, true), step.r)}
               </div>
 
               <div>
                 <h3 className="text-gray-800 font-medium mb-2">Text</h3>
-                <div className="flex space-x-1 overflow-x-auto pb-2">
-                  {text && text.split('').map((char, idx) =>
-                    renderCharacter(char, idx, step.l, false)
-                  )}
-                </div>
+                {cellRow(text, (char, idx) => renderCharacter(char, idx, step.l, false), step.l)}
               </div>
             </div>
             </>
@@ -0,0 +1,104 @@
+import { useEffect, useRef, useState } from 'react';
+
+// Windowed rendering for long traces: only the items inside the viewport
+// (plus OVERSCAN on each side) exist in the DOM, so a list of a million
+// steps costs the same to draw as one of fifty.
+const OVERSCAN = 4;
+
+function visibleRange(offset, viewport, itemSize, count) {
+  const first = Math.max(0, Math.floor(offset / itemSize) - OVERSCAN);
+  const last = Math.min(count, Math.ceil((offset + viewport) / itemSize) + OVERSCAN);
+  return [first, last];
+}
+
+// A fixed-size list along one axis. Items come either from `items` or, for
+// lists too long to hold, from load(from, count) returning a Promise of them.
+// `size` is the viewport length along the axis; a horizontal list is
+// `crossSize` tall. `scrollTo` keeps that index in view when it changes.
+export function VirtualList({
+  count, itemSize, size, crossSize = 56, horizontal = false, items, load, renderItem, scrollTo, className = '',
+}) {
+  const ref = useRef(null);
+  const [offset, setOffset] = useState(0);
+  const [loaded, setLoaded] = useState({ from: 0, items: [] });
+  const [first, last] = visibleRange(offset, size, itemSize, count);
+
+  useEffect(() => {
+    if (!load || last <= first) return;
+    let live = true;
+    load(first, last - first).then((rows) => live && setLoaded({ from: first, items: rows }));
+    return () => { live = false; };
+  }, [load, first, last]);
+
+  useEffect(() => {
+    const el = ref.current;
+    if (!el || scrollTo == null || scrollTo < 0) return;
+    const start = scrollTo * itemSize;
+    const current = horizontal ? el.scrollLeft : el.scrollTop;
+    if (start < current || start + itemSize > current + size) {
+      const target = Math.max(0, start - size / 2);
+      if (horizontal) el.scrollLeft = target;
+      else el.scrollTop = target;
+    }
+  }, [scrollTo, itemSize, size, horizontal]);
+
+  const children = [];
+  for (let i = first; i < last; i++) {
+    const item = items ? items[i] : loaded.items[i - loaded.from];
+    if (item === undefined) continue;
+    const position = horizontal
+      ? { left: i * itemSize, top: 0, width: itemSize, height: '100%' }
+      : { top: i * itemSize, left: 0, height: itemSize, width: '100%' };
+    children.push(
+      <div key={i} style={{ position: 'absolute', ...position }}>
+        {renderItem(item, i)}
+      </div>
+    );
+  }
+
+  return (
+    <div
+      ref={ref}
+      className={`relative ${horizontal ? 'overflow-x-auto' : 'overflow-y-auto'} ${className}`}
+      style={horizontal ? { width: size, maxWidth: '100%', height: crossSize } : { height: size }}
+      onScroll={(e) => setOffset(horizontal ? e.currentTarget.scrollLeft : e.currentTarget.scrollTop)}
+    >
+      <div style={horizontal ? { width: count * itemSize, height: '100%' } : { height: count * itemSize }} className="relative">
+        {children}
+      </div>
+    </div>
+  );
+}
+
+// A fixed-cell grid scrolled in both directions.
+export function VirtualGrid({ rows, cols, cellWidth, cellHeight, width, height, renderCell }) {
+  const [offset, setOffset] = useState({ x: 0, y: 0 });
+  const [top, bottom] = visibleRange(offset.y, height, cellHeight, rows);
+  const [left, right] = visibleRange(offset.x, width, cellWidth, cols);
+
+  const cells = [];
+  for (let i = top; i < bottom; i++) {
+    for (let j = left; j < right; j++) {
+      cells.push(
+        <div
+          key={`${i}:${j}`}
+          style={{ position: 'absolute', top: i * cellHeight, left: j * cellWidth, width: cellWidth, height: cellHeight }}
+        >
+          {renderCell(i, j)}
+        </div>
+      );
+    }
+  }
+
+  return (
+    <div
+      className="relative overflow-auto border"
+      style={{ width, height }}
+      onScroll={(e) => setOffset({ x: e.currentTarget.scrollLeft, y: e.currentTarget.scrollTop })}
+    >
+      <div className="relative" style={{ width: cols * cellWidth, height: rows * cellHeight }}>
+        {cells}
+      </div>
+    </div>
+  );
+}
@@ -1,6 +1,32 @@
-import { useState, useEffect, useRef } from 'react';
+import { useState, useEffect, useRef, useCallback } from 'react';
 import { motion, AnimatePresence } from 'framer-motion';
 import PseudocodePanel from './PseudocodePanel';
+import { VirtualList } from './VirtualList';
+import { loadMessages, withText } from '../messages';
+import { useTrace } from '../useTrace';
+
+// Algorithms the backend can run in step mode: it only computes steps as we
+// ask for them, STEP_BATCH at a time, keeping about that many buffered ahead.
+const STEPPABLE = ['bubble-sort'];
+const STEP_BATCH = 50;
+// Arrays longer than this are drawn as a scrollable window, not all at once.
+const LARGE_ARRAY = 64;
+
+function ArrayStrip({ values, highlight, scrollTo }) {
+  return (
+    <VirtualList
+      horizontal
+      count={values.length}
+      itemSize={56}
+      size={720}
+      items={values}
+      scrollTo={scrollTo}
+      renderItem={(v, i) => (
+        <div className={`mx-1 px-2 py-2 rounded border text-center font-medium truncate ${highlight(i)}`}>{v}</div>
+      )}
+    />
+  );
+}
 
 export default function Visualizer({ selectedAlgorithm }) {
   const [steps, setSteps] = useState([]);
@@ -10,6 +36,15 @@ export default function Visualizer({ selectedAlgorithm }) {
   const [isPlaying, setIsPlaying] = useState(false);
   const intervalRef = useRef(null);
   const [pseudocode, setPseudocode] = useState([]);  // State for pseudocode
+  const [stepMode, setStepMode] = useState(false);
+  const requestedRef = useRef(0);
+  const eventSourceRef = useRef(null);
+  // Full runs are decoded and buffered by the trace worker; step-mode runs are
+  // short and kept in `steps`.
+  const trace = useTrace('sorting');
+  const [fromTrace, setFromTrace] = useState(false);
+  const { seek } = trace;
+  const total = fromTrace ? trace.total : steps.length;
 
   useEffect(() => {
     
@@ -34,7 +69,7 @@ export default function Visualizer({ selectedAlgorithm }) {
   }, [selectedAlgorithm]);  
 
   useEffect(() => {
-    if (isPlaying && currentIndex < steps.length - 1) {
+    if (isPlaying && currentIndex < total - 1) {
       intervalRef.current = setInterval(() => {
         setCurrentIndex((i) => i + 1);
       }, speed);
@@ -42,33 +77,76 @@ export default function Visualizer({ selectedAlgorithm }) {
       clearInterval(intervalRef.current);
     }
     return () => clearInterval(intervalRef.current);
-  }, [isPlaying, currentIndex, speed, steps]);
+  }, [isPlaying, currentIndex, speed, total]);
+
+  const available = currentIndex < trace.total;
+  useEffect(() => {
+    if (fromTrace && available) seek(currentIndex);
+  }, [fromTrace, currentIndex, available, seek]);
+
+  // Like step mode, a full run starts playing once it is complete.
+  useEffect(() => {
+    if (fromTrace && trace.done) {
+      setCurrentIndex(0);
+      setIsPlaying(true);
+    }
+  }, [fromTrace, trace.done]);
+
+  const requestSteps = (count) => {
+    requestedRef.current += count;
+    fetch('http://localhost:5000/next', {
+      method: 'POST',
+      headers: { 'Content-Type': 'application/json' },
+      body: JSON.stringify({ count }),
+    });
+  };
+
+  // In step mode, top up the buffer whenever playback gets close to its end.
+  useEffect(() => {
+    if (!stepMode) return;
+    if (requestedRef.current - currentIndex <= STEP_BATCH / 2) {
+      requestSteps(STEP_BATCH);
+    }
+  }, [stepMode, currentIndex]);
 
   const handleRun = async () => {
+    eventSourceRef.current?.close();
+    trace.stop();
+    setFromTrace(false);
     setSteps([]);
     setCurrentIndex(0);
     setIsPlaying(false);
+    setStepMode(false);
+    requestedRef.current = 0;
 
-    const inputArray = arrayInput.trim()
-      ? arrayInput.split(',').map(Number)
-      : undefined;
+    const tokens = arrayInput.trim() ? arrayInput.split(',').map((t) => t.trim()) : [];
+    const numeric = tokens.every((t) => t !== '' && !Number.isNaN(Number(t)));
+    const inputArray = tokens.length ? (numeric ? tokens.map(Number) : tokens) : undefined;
+    // Element type for the sorting binary: anything non-numeric is sorted as text.
+    const type = !numeric ? 'string'
+      : inputArray?.some((v) => !Number.isInteger(v)) ? 'double'
+      : inputArray?.some((v) => Math.abs(v) > 2147483647) ? 'int64'
+      : 'int';
 
-    await fetch(`http://localhost:5000/run-${selectedAlgorithm}`, {
+    const res = await fetch(`http://localhost:5000/run-${selectedAlgorithm}`, {
       method: 'POST',
       headers: { 'Content-Type': 'application/json' },
-      body: JSON.stringify({ array: inputArray }),
+      body: JSON.stringify({ array: inputArray, type, stepMode: STEPPABLE.includes(selectedAlgorithm) }),
     });
+    const { stepMode: stepping } = await res.json();
 
-    const eventSource = new EventSource('http://localhost:5000/stream');
-    const received = [];
-
-    eventSource.onmessage = (e) => {
-      const data = JSON.parse(e.data);
-      received.push(data);
-      setSteps([...received]);
-    };
+    // A full run arrives over the WebSocket transport and is decoded by the
+    // trace worker. Step mode stays on SSE: its steps trickle in a batch at a
+    // time anyway.
+    if (!stepping) {
+      setFromTrace(true);
+      trace.start();
+      return;
+    }
+    const messages = await loadMessages();
 
-    eventSource.addEventListener('end', () => {
+    const received = [];
+    const finish = () => {
       const last = received[received.length - 1];
       const finalStep = {
         action: 'final',
@@ -77,13 +155,33 @@ export default function Visualizer({ selectedAlgorithm }) {
       };
       received.push(finalStep);
       setSteps([...received]);
-      eventSource.close();
-      setCurrentIndex(0);
+      eventSourceRef.current?.close();
+      setStepMode(false);
+    };
+
+    const eventSource = new EventSource('http://localhost:5000/stream');
+    eventSourceRef.current = eventSource;
+
+    eventSource.onopen = () => {
+      eventSource.onopen = null;
+      setStepMode(true);
       setIsPlaying(true);
-    });
+    };
+
+    eventSource.onmessage = (e) => {
+      const data = withText(messages, JSON.parse(e.data));
+      received.push(data);
+      setSteps([...received]);
+    };
+
+    eventSource.addEventListener('end', finish);
   };
 
-  const currentStep = steps[currentIndex];
+  const currentStep = fromTrace ? trace.current?.step : steps[currentIndex];
+  const loadSteps = useCallback(
+    (from, count) => (fromTrace ? trace.rows(from, count) : Promise.resolve(steps.slice(from, from + count))),
+    [fromTrace, trace.rows, steps]
+  );
   const isSwapping = ['swap', 'pivot-swap'].includes(currentStep?.action);
   const currentLine = currentStep?.line ?? null;
 
@@ -125,7 +223,7 @@ export default function Visualizer({ selectedAlgorithm }) {
         <button className="bg-gray-600 text-white px-4 py-2 rounded" onClick={() => setCurrentIndex((i) => Math.max(i - 1, 0))}>
           Prev
         </button>
-        <button className="bg-gray-600 text-white px-4 py-2 rounded" onClick={() => setCurrentIndex((i) => Math.min(i + 1, steps.length - 1))}>
+        <button className="bg-gray-600 text-white px-4 py-2 rounded" onClick={() => setCurrentIndex((i) => Math.min(i + 1, total - 1))}>
           Next
         </button>
       </div>
@@ -145,6 +243,16 @@ export default function Visualizer({ selectedAlgorithm }) {
                 className="flex flex-col items-center space-y-6"
               >
                 {/* Array display */}
+                {currentStep.array.length > LARGE_ARRAY ? (
+                  <ArrayStrip
+                    values={currentStep.array}
+                    scrollTo={currentStep.swap?.[0] ?? currentStep.pivotIndex}
+                    highlight={(i) =>
+                      currentStep.pivotIndex === i ? 'bg-blue-200'
+                      : currentStep.swap?.includes(i) ? 'bg-yellow-100'
+                      : ''}
+                  />
+                ) : (
                 <div className="flex flex-wrap justify-center gap-2 relative">
                   {currentStep.array.map((val, i) => {
                     const isPivot = currentStep.pivotIndex === i;
@@ -164,6 +272,7 @@ export default function Visualizer({ selectedAlgorithm }) {
                     );
                   })}
                 </div>
+                )}
 
                 {isSwapping && <div className="text-2xl mt-2">↔️</div>}
 
@@ -180,6 +289,11 @@ export default function Visualizer({ selectedAlgorithm }) {
               <h3 className="text-lg font-semibold mb-2 text-center text-green-700">
                  Final Sorted Array
               </h3>
+              {currentStep.array.length > LARGE_ARRAY ? (
+                <div className="mb-4">
+                  <ArrayStrip values={currentStep.array} highlight={() => 'bg-green-100'} />
+                </div>
+              ) : (
               <div className="flex justify-center flex-wrap gap-2 mb-4">
                 {currentStep.array.map((v, i) => (
                   <div key={i} className="px-3 py-1 border rounded bg-green-100 shadow text-sm font-medium">
@@ -187,23 +301,30 @@ export default function Visualizer({ selectedAlgorithm }) {
                   </div>
                 ))}
               </div>
+              )}
               <h4 className="text-md font-semibold mb-2 text-gray-700 text-center"> Step History</h4>
-              <div className="space-y-4">
-                {steps.map((step, idx) => (
-                  <div key={idx} className="flex flex-col items-center">
-                    <div className="flex space-x-2 justify-center flex-wrap">
-                      {step.array.map((v, i) => (
+              {/* One line per step, only the visible ones rendered; long arrays are cut short. */}
+              <VirtualList
+                count={total}
+                itemSize={64}
+                size={300}
+                load={loadSteps}
+                renderItem={(step) => (
+                  <div className="flex flex-col items-center">
+                    <div className="flex space-x-2 justify-center overflow-hidden whitespace-nowrap">
+                      {step.array.slice(0, 24).map((v, i) => (
                         <div key={i} className="px-3 py-1 border rounded bg-gray-100 shadow-sm text-sm">
                           {v}
                         </div>
                       ))}
+                      {step.array.length > 24 && <div className="px-1 text-sm">…</div>}
                     </div>
-                    <div className="text-gray-500 text-xs italic mt-1 text-center max-w-sm">
+                    <div className="text-gray-500 text-xs italic mt-1 text-center max-w-sm truncate">
                       {step.message}
                     </div>
                   </div>
-                ))}
-              </div>
+                )}
+              />
             </div>
           )}
         </div>        
@@ -0,0 +1,36 @@
+// Step messages arrive as a template ID plus integer arguments ("msg" and
+// "args"); the templates are fetched from the backend once and shared.
+//
+// In a template, {k} is argument k, {[k]} the element at index (argument k)
+// of the step's array, and {k:char} argument k as a character ("end" if
+// negative).
+
+let templates = null;
+
+export function loadMessages() {
+  if (!templates) {
+    templates = fetch('http://localhost:5000/messages')
+      .then((res) => (res.ok ? res.json() : []))
+      .catch(() => []);
+  }
+  return templates;
+}
+
+export function formatMessage(table, step) {
+  const template = table[step.msg];
+  if (template === undefined) return '';
+  const args = step.args ?? [];
+  return template.replace(/\{(\[)?(\d+)\]?(:char)?\}/g, (_, element, k, char) => {
+    const arg = args[Number(k)];
+    if (element) return String(step.array?.[arg] ?? '');
+    if (char) return arg < 0 ? 'end' : String.fromCharCode(arg);
+    return String(arg);
+  });
+}
+
+// Returns the step with its text filled in under `field` (steps that already
+// carry text are returned unchanged).
+export function withText(table, step, field = 'message') {
+  if (step.msg === undefined) return step;
+  return { ...step, [field]: formatMessage(table, step) };
+}
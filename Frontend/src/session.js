@@ -0,0 +1,4 @@
+// Identifies this page to the server for incremental re-runs: algorithms
+// that support it keep their last result per session and redo only what an
+// edited input changes. A reload starts a new session.
+export const sessionId = crypto.randomUUID();
@@ -0,0 +1,60 @@
+// How each visualizer reads its trace, used by the trace worker:
+//
+//   field          where withText puts a step's message text
+//   accept(step)   whether the line is a playback step
+//   meta(step)     whether the line carries run-wide data (a graph, the
+//                  searched text, a final result, the work a session re-run
+//                  saved) the view keeps on its own
+//   initial()      state before the first step, for views that accumulate
+//   fold(s, step)  state after `step` (may update s in place); views whose
+//                  steps are self-contained have no fold
+//   finish(last)   an extra step appended once the trace ends, if any
+
+const sorting = () => ({
+  field: 'message',
+  accept: () => true,
+  meta: () => false,
+  finish: (last) => ({ action: 'final', array: last?.array ?? [], message: 'Sorting complete' }),
+});
+
+// Fibonacci fills one row; knapsack and the alignments fill a table row by
+// row from dpRow steps.
+const dp = ({ algorithm }) => {
+  const fibonacci = algorithm === 'dp-fibonacci';
+  return {
+    field: 'message',
+    accept: (step) =>
+      fibonacci ? 'result' in step && step.message !== 'Fibonacci complete' : 'dpRow' in step,
+    meta: (step) => 'finalValue' in step || step.type === 'incremental',
+    initial: () => [],
+    fold(matrix, step) {
+      if (fibonacci) {
+        if (!matrix.length) matrix.push([]);
+        matrix[0].push(step.result);
+        return matrix;
+      }
+      const cols = step.dpRow.length;
+      while (matrix.length <= step.step) matrix.push(Array(cols).fill(0));
+      matrix[step.step] = step.dpRow;
+      return matrix;
+    },
+  };
+};
+
+const greedy = () => ({
+  field: 'explanation',
+  accept: (step) => ['visit', 'update', 'include'].includes(step.type),
+  meta: (step) => ['init', 'final', 'end', 'error', 'incremental'].includes(step.type),
+});
+
+const string = () => ({
+  field: 'message',
+  accept: (step) => step.type !== 'incremental',
+  meta: (step) => typeof step.text === 'string' || typeof step.pattern === 'string' || step.type === 'incremental',
+});
+
+const models = { sorting, dp, greedy, string };
+
+export function createModel(name, options = {}) {
+  return models[name](options);
+}
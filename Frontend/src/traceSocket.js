@@ -0,0 +1,85 @@
+import { io } from 'socket.io-client';
+
+function parseLine(line) {
+  try {
+    return JSON.parse(line);
+  } catch {
+    return null;
+  }
+}
+
+const nextFrame = (f) => (globalThis.requestAnimationFrame ? requestAnimationFrame(f) : setTimeout(f, 0));
+
+// Trace delivery over the backend's binary WebSocket transport
+// (Backend/trace_socket.js): many steps per frame instead of one SSE message
+// per step.
+//
+// onSteps(steps, first) receives each frame's steps already parsed (null for
+// a line that is not JSON); first is the line number of steps[0]. A frame is
+// acknowledged through `schedule`, by default on the next animation frame
+// after it was handled, so the server never runs more than `window` frames
+// ahead of what has been drawn. After a dropped connection the subscription
+// resumes at the first step not yet received.
+//
+// Passing `run` and `from` replays an earlier run from that line, if the
+// server still has it.
+export function openTraceSocket({
+  onSteps, onEnd, onError, window = 4, run = null, from = 0,
+  schedule = nextFrame,
+}) {
+  const socket = io('http://localhost:5000', { transports: ['websocket'], forceNew: true });
+  const decoder = new TextDecoder();
+  let next = from;
+  let finished = false;
+
+  socket.on('connect', () => {
+    socket.emit('subscribe', { run, from: next, window });
+  });
+
+  socket.on('run', (info) => {
+    // Reconnected to a server that no longer has our run.
+    if (run !== null && info.run !== run) {
+      finished = true;
+      socket.close();
+      onError?.('The run is no longer available');
+      return;
+    }
+    run = info.run;
+    next = info.from;
+  });
+
+  socket.on('steps', ({ first, count }, payload) => {
+    // Frames after a resubscribe may overlap what we already have.
+    const skip = next - first;
+    if (skip < count) {
+      const lines = decoder.decode(payload).split('\n');
+      onSteps(lines.slice(Math.max(0, skip)).map(parseLine), Math.max(first, next));
+      next = first + count;
+    }
+    schedule(() => socket.emit('ack'));
+  });
+
+  socket.on('end', ({ error }) => {
+    finished = true;
+    socket.close();
+    if (error) onError?.(error);
+    else onEnd?.();
+  });
+
+  socket.on('connect_error', (err) => {
+    if (!finished && !socket.active) onError?.(err.message);
+  });
+
+  return {
+    get run() {
+      return run;
+    },
+    setWindow(n) {
+      socket.emit('window', n);
+    },
+    close() {
+      finished = true;
+      socket.close();
+    },
+  };
+}
@@ -0,0 +1,217 @@
+import { loadMessages, withText } from './messages';
+import { openTraceSocket } from './traceSocket';
+import { createModel } from './traceModels';
+
+// Decodes and buffers a run's trace off the main thread (see useTrace.js).
+//
+// Playback steps are numbered in trace order and kept in chunks of CHUNK.
+// Only the newest `window` chunks touched stay decoded; for every chunk the
+// worker also keeps a keyframe: the line it starts at in the server's trace
+// and, for views that accumulate state, that state just before its first
+// step. A step in an evicted chunk is fetched again by replaying the run from
+// the chunk's keyframe line, and the state at any step is the keyframe's
+// state with the chunk's steps up to it folded in. Memory stays bounded by
+// the window however long the trace is.
+//
+// From the page:
+//   { type: 'start', model, options, window }
+//   { type: 'get', id, index }          -> { type: 'step', id, index, step, state }
+//   { type: 'rows', id, from, count }   -> { type: 'rows', id, from, steps }
+// To the page, unprompted:
+//   { type: 'progress', total, done, error }   at most every PROGRESS_MS
+//   { type: 'meta', step }                     run-wide lines, in order
+
+const CHUNK = 1024;
+const DEFAULT_WINDOW = 64;
+const PROGRESS_MS = 50;
+const ackNow = (f) => f();
+
+let trace = null;
+
+class Trace {
+  constructor(model, table, window) {
+    this.model = model;
+    this.table = table;
+    this.window = window;
+    this.chunks = new Map(); // chunk -> steps, least recently used first
+    this.keyframes = [];
+    this.replays = new Map(); // chunk -> Promise of its steps
+    this.state = model.fold ? model.initial() : null;
+    this.cursor = null; // { index, state } of the last state handed out
+    this.total = 0;
+    this.last = null;
+    this.extra = null;
+    this.done = false;
+    this.error = null;
+    this.progressTimer = null;
+
+    this.socket = openTraceSocket({
+      schedule: ackNow,
+      onSteps: (steps, first) => steps.forEach((step, k) => step && this.add(step, first + k)),
+      onEnd: () => this.finish(null),
+      onError: (error) => this.finish(String(error)),
+    });
+  }
+
+  add(raw, line) {
+    const step = withText(this.table, raw, this.model.field);
+    if (this.model.meta(step)) postMessage({ type: 'meta', step });
+    if (!this.model.accept(step)) return;
+    this.append(step, line);
+    this.reportProgress();
+  }
+
+  append(step, line) {
+    const chunk = Math.floor(this.total / CHUNK);
+    if (this.total % CHUNK === 0) {
+      this.keyframes[chunk] = { line, state: this.model.fold ? structuredClone(this.state) : null };
+      this.chunks.set(chunk, []);
+      this.evict();
+    }
+    this.chunks.get(chunk)?.push(step);
+    if (this.model.fold) this.state = this.model.fold(this.state, step);
+    this.last = step;
+    this.total++;
+  }
+
+  finish(error) {
+    if (this.done) return;
+    const extra = !error && this.model.finish?.(this.last);
+    // The extra step has no line of its own; a replay of its chunk stops
+    // at the end of the trace, so it is appended there again.
+    if (extra) {
+      this.extra = extra;
+      this.append(extra, Infinity);
+    }
+    this.done = true;
+    this.error = error;
+    this.reportProgress(true);
+  }
+
+  reportProgress(now = false) {
+    if (this.progressTimer && !now) return;
+    clearTimeout(this.progressTimer);
+    this.progressTimer = setTimeout(() => {
+      this.progressTimer = null;
+      postMessage({ type: 'progress', total: this.total, done: this.done, error: this.error });
+    }, now ? 0 : PROGRESS_MS);
+  }
+
+  // Keeps the chunk being filled plus the `window` most recently used.
+  evict() {
+    const filling = Math.floor(Math.max(0, this.total - 1) / CHUNK);
+    for (const chunk of this.chunks.keys()) {
+      if (this.chunks.size <= this.window) break;
+      if (chunk !== filling && chunk !== filling + 1) this.chunks.delete(chunk);
+    }
+  }
+
+  async chunk(c) {
+    const steps = this.chunks.get(c);
+    if (steps) {
+      this.chunks.delete(c);
+      this.chunks.set(c, steps);
+      return steps;
+    }
+    if (!this.replays.has(c)) {
+      this.replays.set(c, this.replay(c).finally(() => this.replays.delete(c)));
+    }
+    return this.replays.get(c);
+  }
+
+  // Re-reads chunk c from the server, starting at its keyframe line.
+  replay(c) {
+    const want = Math.min(CHUNK, this.total - c * CHUNK);
+    return new Promise((resolve, reject) => {
+      const steps = [];
+      let settled = false;
+      const done = () => {
+        if (settled) return;
+        settled = true;
+        socket.close();
+        if (steps.length < want && this.extra) steps.push(this.extra);
+        this.chunks.set(c, steps);
+        this.evict();
+        resolve(steps);
+      };
+      const socket = openTraceSocket({
+        run: this.socket.run,
+        from: this.keyframes[c].line,
+        schedule: ackNow,
+        onSteps: (batch) => {
+          for (const raw of batch) {
+            if (!raw || steps.length === want) continue;
+            const step = withText(this.table, raw, this.model.field);
+            if (this.model.accept(step)) steps.push(step);
+          }
+          if (steps.length === want) done();
+        },
+        onEnd: done,
+        onError: reject,
+      });
+    });
+  }
+
+  async step(index) {
+    const c = Math.floor(index / CHUNK);
+    const steps = await this.chunk(c);
+    const step = steps[index - c * CHUNK];
+    if (!this.model.fold) return { step, state: null };
+
+    // Sequential playback folds one step at a time from the last answer.
+    let { cursor } = this;
+    if (!cursor || cursor.index > index || Math.floor(cursor.index / CHUNK) !== c) {
+      cursor = { index: c * CHUNK - 1, state: structuredClone(this.keyframes[c].state) };
+    }
+    for (let i = cursor.index + 1; i <= index; i++) {
+      cursor.state = this.model.fold(cursor.state, steps[i - c * CHUNK]);
+    }
+    cursor.index = index;
+    this.cursor = cursor;
+    return { step, state: cursor.state };
+  }
+
+  async rows(from, count) {
+    const end = Math.min(this.total, from + count);
+    const out = [];
+    for (let c = Math.floor(from / CHUNK); c * CHUNK < end; c++) {
+      const steps = await this.chunk(c);
+      const lo = Math.max(from, c * CHUNK), hi = Math.min(end, (c + 1) * CHUNK);
+      for (let i = lo; i < hi; i++) out.push(steps[i - c * CHUNK]);
+    }
+    return out;
+  }
+
+  close() {
+    this.socket.close();
+    clearTimeout(this.progressTimer);
+  }
+}
+
+self.onmessage = async ({ data }) => {
+  switch (data.type) {
+    case 'start': {
+      trace?.close();
+      const model = createModel(data.model, data.options);
+      const table = await loadMessages();
+      trace = new Trace(model, table, data.window ?? DEFAULT_WINDOW);
+      break;
+    }
+    case 'get': {
+      if (!trace || data.index >= trace.total) return;
+      try {
+        const { step, state } = await trace.step(data.index);
+        postMessage({ type: 'step', id: data.id, index: data.index, step, state });
+      } catch (error) {
+        postMessage({ type: 'progress', total: trace.total, done: trace.done, error: String(error) });
+      }
+      break;
+    }
+    case 'rows': {
+      if (!trace) return;
+      const steps = await trace.rows(data.from, data.count).catch(() => []);
+      postMessage({ type: 'rows', id: data.id, from: data.from, steps });
+      break;
+    }
+  }
+};
@@ -0,0 +1,77 @@
+import { useCallback, useEffect, useRef, useState } from 'react';
+
+// A run's trace, decoded and buffered by traceWorker.js so that parsing and
+// storage stay off the main thread. The page holds only what it shows:
+//
+//   start(options)     begin receiving the run just started on the server
+//   stop()             drop the trace and everything shown from it
+//   seek(index)        make step `index` (and the state up to it) current
+//   rows(from, count)  Promise of steps [from, from + count), for lists
+//   total, done, error progress of the trace, updated a few times a second
+//   current            { index, step, state } of the last seek, or null
+//   meta               run-wide lines (graph, text, result), in order
+export function useTrace(model) {
+  const workerRef = useRef(null);
+  const pendingRef = useRef(new Map());
+  const seekRef = useRef(0);
+  const nextIdRef = useRef(0);
+  const [progress, setProgress] = useState({ total: 0, done: false, error: null });
+  const [current, setCurrent] = useState(null);
+  const [meta, setMeta] = useState([]);
+
+  const stop = useCallback(() => {
+    workerRef.current?.terminate();
+    workerRef.current = null;
+    pendingRef.current.clear();
+    setProgress({ total: 0, done: false, error: null });
+    setCurrent(null);
+    setMeta([]);
+  }, []);
+
+  useEffect(() => () => workerRef.current?.terminate(), []);
+
+  const start = useCallback((options = {}) => {
+    stop();
+
+    const worker = new Worker(new URL('./traceWorker.js', import.meta.url), { type: 'module' });
+    workerRef.current = worker;
+    worker.onmessage = ({ data }) => {
+      if (workerRef.current !== worker) return;
+      switch (data.type) {
+        case 'progress':
+          setProgress({ total: data.total, done: data.done, error: data.error });
+          break;
+        case 'meta':
+          setMeta((m) => [...m, data.step]);
+          break;
+        case 'step':
+          // Answers to superseded seeks are dropped.
+          if (data.id === seekRef.current) setCurrent({ index: data.index, step: data.step, state: data.state });
+          break;
+        case 'rows':
+          pendingRef.current.get(data.id)?.(data.steps);
+          pendingRef.current.delete(data.id);
+          break;
+      }
+    };
+    worker.postMessage({ type: 'start', model, options });
+  }, [model, stop]);
+
+  const seek = useCallback((index) => {
+    const id = ++nextIdRef.current;
+    seekRef.current = id;
+    workerRef.current?.postMessage({ type: 'get', id, index });
+  }, []);
+
+  const rows = useCallback((from, count) => {
+    const worker = workerRef.current;
+    if (!worker) return Promise.resolve([]);
+    const id = ++nextIdRef.current;
+    return new Promise((resolve) => {
+      pendingRef.current.set(id, resolve);
+      worker.postMessage({ type: 'rows', id, from, count });
+    });
+  }, []);
+
+  return { start, stop, seek, rows, current, meta, ...progress };
+}